@@ -0,0 +1,123 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "Allocations.hpp"
+
+static std::atomic<bool> tracking(false);
+static std::atomic<uint64_t> total_count(0);
+static std::atomic<uint64_t> total_bytes(0);
+static std::atomic<int64_t> live_bytes(0);
+static std::atomic<int64_t> peak_bytes(0);
+static thread_local AllocationStats thread_stats;
+
+bool isTrackingAllocations()
+{
+	return tracking.load(std::memory_order_relaxed);
+}
+
+void setAllocationTracking(bool tracking)
+{
+	::tracking.store(tracking && ALLOCATION_TRACKING, std::memory_order_relaxed);
+}
+
+AllocationStats getAllocations()
+{
+	return AllocationStats{total_count.load(std::memory_order_relaxed), total_bytes.load(std::memory_order_relaxed)};
+}
+
+AllocationStats getThreadAllocations()
+{
+	return thread_stats;
+}
+
+int64_t getLiveBytes()
+{
+	return live_bytes.load(std::memory_order_relaxed);
+}
+
+int64_t takePeakBytes()
+{
+	return peak_bytes.exchange(getLiveBytes(), std::memory_order_relaxed);
+}
+
+#if ALLOCATION_TRACKING
+
+// Keeps the blocks handed out aligned like malloc's
+struct alignas(std::max_align_t) AllocationHeader
+{
+	size_t size;
+	bool counted;
+};
+
+static void *allocate(size_t size)
+{
+	AllocationHeader *header = (AllocationHeader *)malloc(sizeof(AllocationHeader) + size);
+
+	if (header == nullptr)
+		throw std::bad_alloc();
+
+	header->size = size;
+	header->counted = tracking.load(std::memory_order_relaxed);
+
+	if (header->counted)
+	{
+		int64_t live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+		int64_t peak = peak_bytes.load(std::memory_order_relaxed);
+
+		thread_stats.count++;
+		thread_stats.bytes += size;
+		total_count.fetch_add(1, std::memory_order_relaxed);
+		total_bytes.fetch_add(size, std::memory_order_relaxed);
+		while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+			;
+	}
+
+	return header + 1;
+}
+
+static void deallocate(void *pointer)
+{
+	if (pointer == nullptr)
+		return;
+
+	AllocationHeader *header = (AllocationHeader *)pointer - 1;
+
+	if (header->counted)
+		live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+	free(header);
+}
+
+// The nothrow and aligned versions are left to the standard library, which implements the
+// former with these and keeps the latter apart
+void *operator new(size_t size)
+{
+	return allocate(size);
+}
+
+void *operator new[](size_t size)
+{
+	return allocate(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+	deallocate(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+	deallocate(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+	deallocate(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+	deallocate(pointer);
+}
+
+#endif
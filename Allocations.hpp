@@ -0,0 +1,26 @@
+#ifndef ALLOCATIONS_HPP
+#define ALLOCATIONS_HPP
+
+#include <cstdint>
+#include "settings.hpp"
+
+struct AllocationStats
+{
+	uint64_t count;
+	uint64_t bytes;
+};
+
+// Counts what goes through the global operator new while tracking is on, ft::vector and
+// ft::matrix storage included since std::allocator allocates with it. Every block carries
+// a small header with its size so that deletes can be counted too; live bytes only cover
+// the blocks allocated while tracking. With ALLOCATION_TRACKING set to 0 operator new is
+// left alone and everything reads 0.
+bool isTrackingAllocations();
+void setAllocationTracking(bool tracking);
+
+AllocationStats getAllocations();		// every thread's, since the program started
+AllocationStats getThreadAllocations(); // the calling thread's only
+int64_t getLiveBytes();
+int64_t takePeakBytes(); // highest live bytes since the last call, which starts over from now
+
+#endif
@@ -64,3 +64,100 @@ Animation linear_interpolation(const Animation &a, const Animation &b, float t)
 		linear_interpolation(a.scale, b.scale, t),
 		linear_interpolation(a.color, b.color, t));
 }
+
+BoneMask::BoneMask(size_t bone_count) : bone_count(bone_count), bits((bone_count + 63) / 64, 0)
+{
+}
+
+bool BoneMask::test(size_t bone) const
+{
+	return bits[bone / 64] >> (bone % 64) & 1;
+}
+
+void BoneMask::set(size_t bone)
+{
+	bits[bone / 64] |= (uint64_t)1 << (bone % 64);
+}
+
+size_t BoneMask::count() const
+{
+	size_t count = 0;
+
+	for (uint64_t word : bits)
+		count += __builtin_popcountll(word);
+
+	return count;
+}
+
+// 12 floats per bone: translation, rotation, scale and color
+void flattenPose(const std::vector<Animation> &pose, float *channels)
+{
+	for (const Animation &animation : pose)
+		for (const vec &channel : {animation.translation, animation.rotation, animation.scale, animation.color})
+			for (size_t c = 0; c < 3; c++)
+				*channels++ = channel[c];
+}
+
+std::vector<Animation> unflattenPose(const float *channels, size_t bone_count)
+{
+	std::vector<Animation> pose;
+
+	for (size_t bone = 0; bone < bone_count; bone++, channels += 12)
+		pose.push_back(Animation(vec({channels[0], channels[1], channels[2]}), vec({channels[3], channels[4], channels[5]}),
+								 vec({channels[6], channels[7], channels[8]}), vec({channels[9], channels[10], channels[11]})));
+
+	return pose;
+}
+
+// The time of each keyframe, then its pose
+std::vector<float> flattenClip(const Animations &clip)
+{
+	std::vector<float> values;
+
+	for (const auto &[time, pose] : clip)
+	{
+		values.push_back(time);
+		values.resize(values.size() + 12 * pose.size());
+		flattenPose(pose, &values[values.size() - 12 * pose.size()]);
+	}
+
+	return values;
+}
+
+Animations unflattenClip(const std::vector<float> &values, size_t bone_count)
+{
+	Animations clip;
+
+	for (size_t i = 0; bone_count > 0 && i + 1 + 12 * bone_count <= values.size(); i += 1 + 12 * bone_count)
+		clip[values[i]] = unflattenPose(&values[i + 1], bone_count);
+
+	return clip;
+}
+
+std::vector<Animation> sampleAnimations(const Animations &a, float t)
+{
+	auto before = a.lower_bound(t);
+	auto after = a.upper_bound(t);
+
+	if (before != a.begin())
+		before--;
+	if (after == a.end())
+		after--;
+	t = (t - before->first) / (after->first - before->first);
+
+	std::vector<Animation> animations;
+
+	for (size_t i = 0; i < before->second.size(); i++)
+	{
+		Animation animation;
+
+		if (std::isinf(t))
+			animation = before->second[i];
+		else
+			animation = linear_interpolation(before->second[i], after->second[i], t);
+
+		animations.push_back(animation);
+	}
+
+	return animations;
+}
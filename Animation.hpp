@@ -1,7 +1,11 @@
 #ifndef ANIMATION_HPP
 #define ANIMATION_HPP
 
+#include <cstdint>
 #include <iostream>
+#include <map>
+#include <string>
+#include <vector>
 #include "ft_vec.hpp"
 
 typedef ft::vector<float> vec;
@@ -27,6 +31,35 @@ public:
 	friend std::ostream &operator<<(std::ostream &os, const Animation &animation);
 	friend std::istream &operator>>(std::istream &is, Animation &animation);
 	friend Animation linear_interpolation(const Animation &a, const Animation &b, float t);
+	friend void flattenPose(const std::vector<Animation> &pose, float *channels);
 };
 
+typedef std::map<float, std::vector<Animation>> Animations;
+
+// One bit per bone, in the order of the bones of a pose
+struct BoneMask
+{
+	size_t bone_count;
+	std::vector<uint64_t> bits;
+
+	BoneMask(size_t bone_count = 0);
+
+	bool test(size_t bone) const;
+	void set(size_t bone);
+	size_t count() const;
+};
+
+std::vector<Animation> sampleAnimations(const Animations &a, float t);
+void flattenPose(const std::vector<Animation> &pose, float *channels);
+std::vector<Animation> unflattenPose(const float *channels, size_t bone_count);
+std::vector<float> flattenClip(const Animations &clip);
+Animations unflattenClip(const std::vector<float> &values, size_t bone_count);
+
+void saveAnimations(const std::string name, const Animations &a);
+std::map<std::string, Animations> loadAnimationsFromDir(std::string dir_path, const std::vector<size_t> &bone_counts);
+Animations loadAnimations(const std::string name, const std::vector<size_t> &bone_counts);
+std::vector<Animation> parseAnimations(std::vector<std::string> string_animations);
+std::vector<std::string> split_set(std::string s, std::string delimiter);
+bool are_animations_valid(Animations &a, const std::vector<size_t> &bone_counts);
+
 #endif
@@ -8,55 +8,6 @@ Bone::Bone(string name, Bone *parent, vec dims, vec jointPos, vec jointRot, vec
 	default_jointRot = jointRot;
 	default_dims = dims;
 	default_color = color;
-
-	float vertices[] = {
-		-0.5f, -0.5f, -0.5f,
-		0.5f, -0.5f, -0.5f,
-		0.5f, 0.5f, -0.5f,
-		-0.5f, 0.5f, -0.5f,
-
-		-0.5f, -0.5f, 0.5f,
-		0.5f, -0.5f, 0.5f,
-		0.5f, 0.5f, 0.5f,
-		-0.5f, 0.5f, 0.5f};
-
-	// this way the cube sits on the origin and the rotation is the cube's orientation wihtout having to translate it
-	for (int i = 1; i < 24; i += 3)
-		vertices[i] += 0.5;
-
-	uint indices[] = {
-		0, 1, 2, 2, 3, 0,
-		4, 5, 6, 6, 7, 4,
-		0, 3, 7, 7, 4, 0,
-		1, 2, 6, 6, 5, 1,
-		3, 2, 6, 6, 7, 3,
-		0, 1, 5, 5, 4, 0};
-
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-
-	glBindVertexArray(VAO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-	glEnableVertexAttribArray(0);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	glBindVertexArray(0);
-}
-
-Bone::~Bone()
-{
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
 }
 
 vec &Bone::getColor()
@@ -128,24 +79,6 @@ size_t Bone::getChildrenCount()
 	return count;
 }
 
-void Bone::renderModel(GLuint shaderProgram)
-{
-	render(shaderProgram);
-
-	for (Bone *child : children)
-		child->renderModel(shaderProgram);
-}
-
-void Bone::render(GLuint shaderProgram)
-{
-	vec buff_model(transform.begin(), transform.end());
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uModel"), 1, GL_FALSE, &buff_model[0]);
-	glUniform3fv(glGetUniformLocation(shaderProgram, "Color"), 1, &color[0]);
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
-}
-
 void Bone::clear()
 {
 	for (Bone *child : children)
@@ -202,6 +135,27 @@ void Bone::applyAnimations(std::vector<Animation> animations)
 	}
 }
 
+void Bone::setAnimations(const std::vector<Animation> &animations)
+{
+	PROFILE_SCOPE(BoneZone);
+
+	setAnimations(animations, 0);
+}
+
+size_t Bone::setAnimations(const std::vector<Animation> &animations, size_t index)
+{
+	setJointPos(animations[index].getTranslation());
+	setJointRot(animations[index].getRotation());
+	setDims(animations[index].getScale());
+	setColor(animations[index].getColor());
+	index++;
+
+	for (Bone *child : children)
+		index = child->setAnimations(animations, index);
+
+	return index;
+}
+
 void Bone::setTransforms(std::vector<mat> transforms)
 {
 	transform = transforms[0];
@@ -245,38 +199,21 @@ void Bone::applyTransforms(mat parentTransform)
 
 Bone *createModel(ModelType model_type)
 {
-	Bone *torso = new Bone("torso", nullptr, vec({1, 2, 0.5}), vec({0, 0, 0}), vec(3), TORSO_COLOR);
-	Bone *head = new Bone("head", torso, vec({0.5, 0.5, 0.5}), vec({0, 1, 0}), vec(3), HEAD_COLOR);
-	Bone *leftBicep = new Bone("leftBicep", torso, vec({0.3, 2.2, 0.3}), vec({0.5, 0.8, 0}), rotationToEuler(rotate(M_PI_2, vec({0, 0, 1}))), LEFT_ARM_COLOR);
-	Bone *rightBicep = new Bone("rightBicep", torso, vec({0.3, 2.2, 0.3}), vec({-0.5, 0.8, 0}), rotationToEuler(rotate(-M_PI_2, vec({0, 0, 1}))), RIGHT_ARM_COLOR);
-	Bone *leftForeArm = new Bone("leftForeArm", leftBicep, vec({0.3, 0.3, 0.3}), vec({0, 1, 0}), vec(3), LEFT_FOREARM_COLOR);
-	Bone *rightForeArm = new Bone("rightForeArm", rightBicep, vec({0.3, 0.3, 0.3}), vec({0, 1, 0}), vec(3), RIGHT_FOREARM_COLOR);
-	Bone *leftThigh = new Bone("leftThigh", torso, vec({0.3, 2.5, 0.3}), vec({-0.4, 0, 0}), rotationToEuler(rotate(M_PI, vec({1, 0, 0}))), LEFT_THIGH_COLOR);
-	Bone *rightThigh = new Bone("rightThigh", torso, vec({0.3, 2.5, 0.3}), vec({0.4, 0, 0}), rotationToEuler(rotate(M_PI, vec({1, 0, 0}))), RIGHT_THIGH_COLOR);
-	Bone *leftCalf = new Bone("leftCalf", leftThigh, vec({0.4, 0.3, 0.8}), vec({0, 1, 0}), vec(3), LEFT_CALF_COLOR);
-	Bone *rightCalf = new Bone("rightCalf", rightThigh, vec({0.4, 0.3, 0.8}), vec({0, 1, 0}), vec(3), RIGHT_CALF_COLOR);
-
-	torso->addChild(leftBicep);
-	torso->addChild(rightBicep);
-	torso->addChild(leftThigh);
-	torso->addChild(rightThigh);
-	torso->addChild(head);
-
-	if (model_type == Alien)
+	Skeleton skeleton = createSkeleton(model_type);
+	std::vector<Bone *> bones;
+
+	for (size_t i = 0; i < skeleton.size(); i++)
 	{
-		Bone *leftAntenna = new Bone("leftAntenna", head, vec({0.1, 1.5, 0.1}), vec({0.2, 0.5, 0}), vec(3), LEFT_ANTENNA_COLOR);
-		Bone *rightAntenna = new Bone("rightAntenna", head, vec({0.1, 1.5, 0.1}), vec({-0.2, 0.5, 0}), vec(3), RIGHT_ANTENNA_COLOR);
+		const Animation &bind = skeleton.bind_pose[i];
+		Bone *parent = skeleton.parents[i] < 0 ? nullptr : bones[skeleton.parents[i]];
+		Bone *bone = new Bone(skeleton.names[i], parent, bind.getScale(), bind.getTranslation(), bind.getRotation(), bind.getColor());
 
-		head->addChild(leftAntenna);
-		head->addChild(rightAntenna);
+		if (parent != nullptr)
+			parent->addChild(bone);
+		bones.push_back(bone);
 	}
 
-	leftBicep->addChild(leftForeArm);
-	rightBicep->addChild(rightForeArm);
-	leftThigh->addChild(leftCalf);
-	rightThigh->addChild(rightCalf);
-
-	return torso;
+	return bones[0];
 }
 
 void boneEditor(Bone *bone)
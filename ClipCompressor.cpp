@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cmath>
+#include "ClipCompressor.hpp"
+#include "settings.hpp"
+
+#define QUANTIZATION_STEPS 65535.0f
+
+size_t CompressedClip::bytes() const
+{
+	return sizeof(CompressedClip) + (times.capacity() + base.capacity() + range.capacity()) * sizeof(float) +
+		   animated.capacity() * sizeof(uint32_t) + samples.capacity() * sizeof(uint16_t);
+}
+
+// Lerps the two kept keyframes around t, clamping to the first and last one.
+// The bones left out of the mask hold their constant values only.
+void CompressedClip::sample(float t, float *channels, const BoneMask *mask) const
+{
+	size_t count = animated.size();
+	size_t second = std::min((size_t)(std::upper_bound(times.begin(), times.end(), t) - times.begin()), times.size() - 1);
+	size_t first = second > 0 ? second - 1 : 0;
+	float span = times[second] - times[first];
+	float alpha = span > 0.0f ? std::fmax(0.0f, std::fmin((t - times[first]) / span, 1.0f)) : 0.0f;
+	const uint16_t *q0 = &samples[first * count];
+	const uint16_t *q1 = &samples[second * count];
+
+	std::copy(base.begin(), base.end(), channels);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t channel = animated[i];
+
+		if (mask != nullptr && !mask->test(channel / 12))
+			continue;
+
+		float scale = range[channel] / QUANTIZATION_STEPS;
+		float v0 = q0[i] * scale;
+		float v1 = q1[i] * scale;
+
+		channels[channel] += v0 + (v1 - v0) * alpha;
+	}
+}
+
+std::vector<Animation> CompressedClip::sample(float t) const
+{
+	std::vector<float> channels(base.size());
+
+	sample(t, channels.data());
+
+	return unflattenPose(channels.data(), bone_count);
+}
+
+// Back to keyframes, one per kept keyframe
+Animations CompressedClip::decompress() const
+{
+	Animations clip;
+
+	for (float time : times)
+		clip[time] = sample(time);
+
+	return clip;
+}
+
+// Whether lerping between keyframes first and last reproduces every keyframe in between,
+// leaving room for the quantization error of each channel
+static bool isReconstructed(const CompressedClip &clip, const std::vector<float> &times, const std::vector<float> &values,
+							size_t first, size_t last, float tolerance)
+{
+	size_t channel_count = clip.base.size();
+
+	for (size_t key = first + 1; key < last; key++)
+	{
+		float alpha = (times[key] - times[first]) / (times[last] - times[first]);
+
+		for (uint32_t channel : clip.animated)
+		{
+			float v0 = values[first * channel_count + channel];
+			float v1 = values[last * channel_count + channel];
+			float budget = tolerance - 0.5f * clip.range[channel] / QUANTIZATION_STEPS;
+
+			if (fabsf(v0 + (v1 - v0) * alpha - values[key * channel_count + channel]) > budget)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+std::shared_ptr<const CompressedClip> compressClip(const Animations &clip, float tolerance)
+{
+	std::shared_ptr<CompressedClip> compressed = std::make_shared<CompressedClip>();
+	size_t key_count = clip.size();
+	size_t bone_count = clip.begin()->second.size();
+	size_t channel_count = 12 * bone_count;
+	std::vector<float> times;
+	std::vector<float> values(key_count * channel_count);
+
+	for (const auto &[time, pose] : clip)
+	{
+		flattenPose(pose, &values[times.size() * channel_count]);
+		times.push_back(time);
+	}
+
+	compressed->bone_count = bone_count;
+	compressed->source_keys = key_count;
+	compressed->source_bytes = key_count * (sizeof(float) + bone_count * (sizeof(Animation) + 12 * sizeof(float)));
+	compressed->base.resize(channel_count);
+	compressed->range.resize(channel_count);
+
+	for (size_t channel = 0; channel < channel_count; channel++)
+	{
+		float min = INFINITY;
+		float max = -INFINITY;
+
+		for (size_t key = 0; key < key_count; key++)
+		{
+			min = std::fmin(min, values[key * channel_count + channel]);
+			max = std::fmax(max, values[key * channel_count + channel]);
+		}
+
+		if (max - min <= tolerance)
+		{
+			compressed->base[channel] = 0.5f * (min + max);
+			continue;
+		}
+
+		compressed->base[channel] = min;
+		compressed->range[channel] = max - min;
+		compressed->animated.push_back(channel);
+	}
+
+	// a keyframe goes when the last kept one and the next one still reproduce everything skipped
+	std::vector<size_t> kept = {0};
+
+	for (size_t key = 1; key + 1 < key_count; key++)
+		if (!isReconstructed(*compressed, times, values, kept.back(), key + 1, tolerance))
+			kept.push_back(key);
+	kept.push_back(key_count - 1);
+
+	for (size_t key : kept)
+	{
+		compressed->times.push_back(times[key]);
+
+		for (uint32_t channel : compressed->animated)
+		{
+			float normalized = (values[key * channel_count + channel] - compressed->base[channel]) / compressed->range[channel];
+
+			compressed->samples.push_back((uint16_t)lroundf(normalized * QUANTIZATION_STEPS));
+		}
+	}
+
+	std::vector<float> channels(channel_count);
+
+	compressed->max_error = 0.0f;
+	for (size_t key = 0; key < key_count; key++)
+	{
+		compressed->sample(times[key], channels.data());
+
+		for (size_t channel = 0; channel < channel_count; channel++)
+			compressed->max_error = std::fmax(compressed->max_error, fabsf(channels[channel] - values[key * channel_count + channel]));
+	}
+
+	return compressed;
+}
+
+ClipCompressor::ClipCompressor() : tolerance(CLIP_COMPRESSION_TOLERANCE), enabled(false)
+{
+}
+
+void ClipCompressor::compress(const std::map<std::string, Animations> &animations)
+{
+	clips.clear();
+
+	// a single keyframe cannot be played, same as in the editor
+	for (const auto &[name, clip] : animations)
+		if (clip.size() > 1)
+			clips[name] = compressClip(clip, tolerance);
+}
+
+void ClipCompressor::invalidate(const std::string &name)
+{
+	clips.erase(name);
+}
+
+void ClipCompressor::clear()
+{
+	clips.clear();
+}
+
+std::shared_ptr<const CompressedClip> ClipCompressor::get(const std::string &name) const
+{
+	auto it = clips.find(name);
+
+	if (!enabled || it == clips.end())
+		return nullptr;
+
+	return it->second;
+}
+
+const std::map<std::string, std::shared_ptr<const CompressedClip>> &ClipCompressor::getClips() const
+{
+	return clips;
+}
+
+size_t ClipCompressor::bytes() const
+{
+	size_t total = 0;
+
+	for (const auto &[name, clip] : clips)
+		total += clip->bytes();
+
+	return total;
+}
+
+float ClipCompressor::getTolerance() const
+{
+	return tolerance;
+}
+
+// Already compressed clips keep their tolerance until they are compressed again
+void ClipCompressor::setTolerance(float tolerance)
+{
+	if (tolerance >= 0.0f)
+		this->tolerance = tolerance;
+}
+
+bool ClipCompressor::isEnabled() const
+{
+	return enabled;
+}
+
+void ClipCompressor::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+}
@@ -0,0 +1,60 @@
+#ifndef CLIPCOMPRESSOR_HPP
+#define CLIPCOMPRESSOR_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include "Animation.hpp"
+
+// A clip flattened into 12 scalar channels per bone (translation, rotation, scale, color),
+// with the channels that never move beyond the tolerance folded into a single value, the
+// keyframes their neighbours reproduce within the tolerance removed, and what is left
+// quantized to 16 bits over the range of each channel
+struct CompressedClip
+{
+	size_t bone_count;
+	std::vector<float> times;		// of the kept keyframes
+	std::vector<float> base;		// per channel: the constant value, or the minimum
+	std::vector<float> range;		// per channel: 0 when constant
+	std::vector<uint32_t> animated; // indices of the channels that are not constant
+	std::vector<uint16_t> samples;	// animated.size() per kept keyframe
+
+	size_t source_keys;
+	size_t source_bytes;
+	float max_error; // over every source keyframe and channel
+
+	size_t bytes() const;
+	void sample(float t, float *channels, const BoneMask *mask = nullptr) const;
+	std::vector<Animation> sample(float t) const;
+	Animations decompress() const;
+};
+
+std::shared_ptr<const CompressedClip> compressClip(const Animations &clip, float tolerance);
+
+// Compressed versions of the loaded clips, looked up by name at play time
+class ClipCompressor
+{
+private:
+	std::map<std::string, std::shared_ptr<const CompressedClip>> clips;
+	float tolerance;
+	bool enabled;
+
+public:
+	ClipCompressor();
+
+	void compress(const std::map<std::string, Animations> &animations);
+	void invalidate(const std::string &name);
+	void clear();
+
+	std::shared_ptr<const CompressedClip> get(const std::string &name) const;
+	const std::map<std::string, std::shared_ptr<const CompressedClip>> &getClips() const;
+	size_t bytes() const;
+
+	float getTolerance() const;
+	void setTolerance(float tolerance);
+	bool isEnabled() const;
+	void setEnabled(bool enabled);
+};
+
+#endif
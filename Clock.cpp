@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cmath>
+#include "Clock.hpp"
+#include "settings.hpp"
+
+Clock::Clock(double step)
+	: step(step), accumulator(0.0), scale(1.0), paused(false), started(false), ticks(0)
+{
+}
+
+size_t Clock::advance()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double real_dt = started ? std::chrono::duration<double>(now - last).count() : 0.0;
+
+	started = true;
+	last = now;
+
+	return advance(real_dt);
+}
+
+size_t Clock::advance(double real_dt)
+{
+	if (paused)
+		return 0;
+
+	accumulator += real_dt * scale;
+
+	size_t steps = (size_t)(accumulator / step);
+
+	// drop the backlog rather than spiral when a frame took far too long
+	if (steps > SIMULATION_MAX_STEPS)
+	{
+		accumulator = fmod(accumulator, step);
+		steps = SIMULATION_MAX_STEPS;
+	}
+	else
+		accumulator -= steps * step;
+
+	ticks += steps;
+
+	return steps;
+}
+
+void Clock::tick()
+{
+	ticks++;
+}
+
+double Clock::getStep() const
+{
+	return step;
+}
+
+float Clock::getAlpha() const
+{
+	return accumulator / step;
+}
+
+size_t Clock::getTicks() const
+{
+	return ticks;
+}
+
+double Clock::getScale() const
+{
+	return scale;
+}
+
+void Clock::setScale(double scale)
+{
+	this->scale = scale < 0.0 ? 0.0 : scale;
+}
+
+bool Clock::isPaused() const
+{
+	return paused;
+}
+
+void Clock::setPaused(bool paused)
+{
+	this->paused = paused;
+}
+
+const char *getPlaybackModeName(PlaybackMode mode)
+{
+	const char *names[PlaybackModeCount] = {"once", "loop", "ping-pong", "clamp"};
+
+	return mode < PlaybackModeCount ? names[mode] : "unknown";
+}
+
+Playback::Playback()
+	: clip(nullptr), baked(nullptr), compressed(nullptr), tracks(nullptr), time(0.0f), scale(1.0f), paused(false), mode(Once), reversed(false), wrap(0.0f)
+{
+}
+
+bool Playback::isPlaying() const
+{
+	return clip != nullptr;
+}
+
+float Playback::getDuration() const
+{
+	return isPlaying() ? clip->rbegin()->first : 0.0f;
+}
+
+// A clip whose last keyframe differs from its first is given one more segment when it loops,
+// as long as its last one, back into the first. The horizontal translation of the root is left
+// out of the comparison: it is how far the clip walks, held through that segment.
+static float getWrap(const Animations &clip)
+{
+	if (clip.size() < 2)
+		return 0.0f;
+
+	size_t count = 12 * clip.begin()->second.size();
+	std::vector<float> first(count), last(count);
+
+	flattenPose(clip.begin()->second, first.data());
+	flattenPose(clip.rbegin()->second, last.data());
+	first[0] = last[0];
+	first[2] = last[2];
+
+	if (first == last)
+		return 0.0f;
+
+	return clip.rbegin()->first - std::next(clip.rbegin())->first;
+}
+
+void Playback::play(std::shared_ptr<const Animations> clip, std::shared_ptr<const BakedClip> baked,
+					std::shared_ptr<const CompressedClip> compressed, std::shared_ptr<const TrackClip> tracks)
+{
+	this->clip = clip;
+	this->baked = baked;
+	this->compressed = compressed;
+	this->tracks = tracks;
+	time = 0.0f;
+	paused = false;
+	reversed = false;
+	wrap = getWrap(*clip);
+}
+
+void Playback::stop()
+{
+	clip.reset();
+	baked.reset();
+	compressed.reset();
+	tracks.reset();
+	time = 0.0f;
+	reversed = false;
+}
+
+void Playback::seek(float time)
+{
+	this->time = std::fmax(0.0f, std::fmin(time, getDuration()));
+}
+
+// Only ping-pong plays backward, the other modes carry on forward from where the playhead is
+void Playback::setMode(PlaybackMode mode)
+{
+	this->mode = mode;
+	if (mode != PingPong)
+		reversed = false;
+}
+
+// Horizontal translation of the root between two times of the clip, added to motion
+static void addRootMotion(const Playback &playback, float from, float to, float *motion)
+{
+	float start[3], end[3];
+
+	if (motion == nullptr)
+		return;
+
+	playback.sampleRoot(from, start);
+	playback.sampleRoot(to, end);
+	motion[0] += end[0] - start[0];
+	motion[2] += end[2] - start[2];
+}
+
+// Playhead dt after from, wrapped or reflected by the mode; past the end when playing once.
+// motion, when given, is added how far the root moves horizontally along the way.
+float Playback::advance(float from, bool &reversed, float dt, float *motion) const
+{
+	float duration = getDuration();
+	float period = duration + wrap;
+	float to = from + (reversed ? -dt : dt) * scale;
+
+	switch (mode)
+	{
+	case Once:
+	case Clamp:
+		addRootMotion(*this, from, std::fmin(to, duration), motion);
+		return mode == Clamp ? std::fmin(to, duration) : to;
+	case Loop:
+		if (to <= period || period <= 0.0f)
+			break;
+		addRootMotion(*this, from, period, motion);
+		to = fmod(to, period);
+		addRootMotion(*this, 0.0f, to, motion);
+		return to;
+	case PingPong:
+		if (to > duration)
+		{
+			addRootMotion(*this, from, duration, motion);
+			to = std::fmax(0.0f, 2.0f * duration - to);
+			reversed = true;
+			addRootMotion(*this, duration, to, motion);
+			return to;
+		}
+		if (to < 0.0f)
+		{
+			addRootMotion(*this, from, 0.0f, motion);
+			to = std::fmin(-to, duration);
+			reversed = false;
+			addRootMotion(*this, 0.0f, to, motion);
+			return to;
+		}
+		break;
+	default:
+		break;
+	}
+
+	addRootMotion(*this, from, to, motion);
+
+	return to;
+}
+
+// motion, when given, receives how far the root moved horizontally during the step
+void Playback::step(float dt, float *motion)
+{
+	if (motion != nullptr)
+		std::fill(motion, motion + 3, 0.0f);
+
+	if (!isPlaying() || paused)
+		return;
+
+	time = advance(time, reversed, dt, motion);
+	if (time > getDuration() + (mode == Loop ? wrap : 0.0f))
+		stop();
+}
+
+// Whether the next step of dt gets to the end of the clip: its last keyframe when it plays once
+// or clamps, the point where it starts over when it loops, the turn back when it ping-pongs
+bool Playback::reachesEnd(float dt) const
+{
+	bool ahead = reversed;
+
+	if (!isPlaying() || paused)
+		return false;
+
+	float to = advance(time, ahead, dt);
+
+	switch (mode)
+	{
+	case Once:
+	case Clamp:
+		return time < getDuration() && to >= getDuration();
+	case Loop:
+		return to < time;
+	case PingPong:
+		return !reversed && ahead;
+	default:
+		return false;
+	}
+}
+
+// motion, when given, receives how far the root moves horizontally from the playhead to the sample
+float Playback::sampleTime(float alpha, float dt, float *motion) const
+{
+	bool ahead = reversed;
+
+	if (motion != nullptr)
+		std::fill(motion, motion + 3, 0.0f);
+
+	if (!isPlaying() || paused)
+		return time;
+
+	return std::fmin(advance(time, ahead, alpha * dt, motion), getDuration() + (mode == Loop ? wrap : 0.0f));
+}
+
+// 12 floats per bone, see flattenPose. The bones left out of the mask may not be written.
+// Past the last keyframe of a looping clip, it is blended back into the first one.
+void Playback::sample(float t, float *channels, const BoneMask *mask) const
+{
+	float duration = getDuration();
+
+	if (t > duration && wrap > 0.0f)
+	{
+		size_t count = 12 * clip->begin()->second.size();
+		std::vector<float> first(count);
+		float u = std::fmin((t - duration) / wrap, 1.0f);
+
+		sample(duration, channels, mask);
+		sample(0.0f, first.data(), mask);
+		for (size_t i = 0; i < count; i++)
+			if (i != 0 && i != 2)
+				channels[i] += (first[i] - channels[i]) * u;
+	}
+	else if (compressed != nullptr)
+		compressed->sample(t, channels, mask);
+	else if (tracks != nullptr)
+		tracks->sample(t, channels, mask);
+	else
+		flattenPose(sampleAnimations(*clip, t), channels);
+}
+
+std::vector<Animation> Playback::sample(float t) const
+{
+	if (t > getDuration() && wrap > 0.0f)
+	{
+		size_t bone_count = clip->begin()->second.size();
+		std::vector<float> channels(12 * bone_count);
+
+		sample(t, channels.data());
+
+		return unflattenPose(channels.data(), bone_count);
+	}
+	if (compressed != nullptr)
+		return compressed->sample(t);
+	if (tracks != nullptr)
+		return tracks->sample(t);
+
+	return sampleAnimations(*clip, t);
+}
+
+// Translation of the first bone, the one that carries the whole rig. It holds past the last
+// keyframe, as the horizontal part of it does in the pose.
+void Playback::sampleRoot(float t, float *translation) const
+{
+	if (tracks != nullptr)
+		return tracks->tracks[0].sample(t, translation);
+
+	vec root = sampleAnimations(*clip, t)[0].getTranslation();
+
+	for (size_t c = 0; c < 3; c++)
+		translation[c] = root[c];
+}
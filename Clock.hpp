@@ -0,0 +1,85 @@
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <chrono>
+#include <memory>
+#include "ClipCompressor.hpp"
+#include "PoseCache.hpp"
+#include "TrackClip.hpp"
+
+// Fixed timestep clock driving the simulation.
+// Real (or explicitly supplied) time is scaled and accumulated, then consumed in
+// whole steps; what is left over gives the interpolation factor for rendering.
+class Clock
+{
+private:
+	double step;
+	double accumulator;
+	double scale;
+	bool paused;
+	bool started;
+	size_t ticks;
+	std::chrono::steady_clock::time_point last;
+
+public:
+	Clock(double step);
+
+	size_t advance();
+	size_t advance(double real_dt);
+	void tick();
+
+	double getStep() const;
+	float getAlpha() const;
+	size_t getTicks() const;
+
+	double getScale() const;
+	void setScale(double scale);
+
+	bool isPaused() const;
+	void setPaused(bool paused);
+};
+
+typedef enum PlaybackMode {
+	Once = 0, // stops at the end of the clip, back to the rest pose
+	Loop,	  // starts over, through a segment blending the last keyframe into the first
+	PingPong, // plays backward from the end, then forward again from the start
+	Clamp,	  // holds the last pose
+	PlaybackModeCount
+} PlaybackMode;
+
+const char *getPlaybackModeName(PlaybackMode mode);
+
+// Playhead of one instance, only ever moved in fixed steps
+struct Playback
+{
+	std::shared_ptr<const Animations> clip;
+	std::shared_ptr<const BakedClip> baked;			  // optional, sampled instead of clip
+	std::shared_ptr<const CompressedClip> compressed; // optional, sampled instead of clip for local poses
+	std::shared_ptr<const TrackClip> tracks;		  // optional, sampled instead of clip otherwise
+	float time;
+	float scale;
+	bool paused;
+	PlaybackMode mode;
+	bool reversed; // playing backward, on the way back of a ping-pong
+	float wrap;	   // length of the segment back into the first keyframe when looping, 0 when they match
+
+	Playback();
+
+	bool isPlaying() const;
+	float getDuration() const;
+
+	void play(std::shared_ptr<const Animations> clip, std::shared_ptr<const BakedClip> baked = nullptr,
+			  std::shared_ptr<const CompressedClip> compressed = nullptr, std::shared_ptr<const TrackClip> tracks = nullptr);
+	void stop();
+	void seek(float time);
+	void setMode(PlaybackMode mode);
+	float advance(float from, bool &reversed, float dt, float *motion = nullptr) const;
+	void step(float dt, float *motion = nullptr);
+	bool reachesEnd(float dt) const;
+	float sampleTime(float alpha, float dt, float *motion = nullptr) const;
+	void sample(float t, float *channels, const BoneMask *mask = nullptr) const;
+	std::vector<Animation> sample(float t) const;
+	void sampleRoot(float t, float *translation) const;
+};
+
+#endif
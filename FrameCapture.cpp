@@ -0,0 +1,207 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "FrameCapture.hpp"
+
+static uint32_t crc32(const unsigned char *data, size_t size, uint32_t crc = 0)
+{
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc ^= data[i];
+		for (int k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	}
+	return ~crc;
+}
+
+static void appendBigEndian(std::vector<unsigned char> &out, uint32_t value)
+{
+	for (int shift = 24; shift >= 0; shift -= 8)
+		out.push_back((value >> shift) & 0xFF);
+}
+
+static void writeChunk(std::ofstream &file, const char *type, const std::vector<unsigned char> &data)
+{
+	std::vector<unsigned char> chunk(type, type + 4);
+
+	chunk.insert(chunk.end(), data.begin(), data.end());
+
+	std::vector<unsigned char> length;
+	std::vector<unsigned char> crc;
+	appendBigEndian(length, data.size());
+	appendBigEndian(crc, crc32(chunk.data(), chunk.size()));
+
+	file.write((const char *)length.data(), length.size());
+	file.write((const char *)chunk.data(), chunk.size());
+	file.write((const char *)crc.data(), crc.size());
+}
+
+// Uncompressed (stored deflate blocks) PNG, so no zlib is needed
+static void writePng(std::ofstream &file, int width, int height, const std::vector<unsigned char> &rgb)
+{
+	const unsigned char signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	std::vector<unsigned char> header;
+	std::vector<unsigned char> raw;
+	std::vector<unsigned char> idat = {0x78, 0x01};
+	uint32_t a = 1, b = 0;
+
+	appendBigEndian(header, width);
+	appendBigEndian(header, height);
+	header.insert(header.end(), {8, 2, 0, 0, 0});
+
+	for (int y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), rgb.begin() + y * width * 3, rgb.begin() + (y + 1) * width * 3);
+	}
+
+	for (size_t offset = 0; offset < raw.size(); offset += 65535)
+	{
+		uint16_t size = std::min(raw.size() - offset, (size_t)65535);
+
+		idat.push_back(offset + size == raw.size());
+		idat.insert(idat.end(), {(unsigned char)size, (unsigned char)(size >> 8), (unsigned char)~size, (unsigned char)(~size >> 8)});
+		idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + size);
+	}
+
+	for (unsigned char c : raw)
+	{
+		a = (a + c) % 65521;
+		b = (b + a) % 65521;
+	}
+	appendBigEndian(idat, (b << 16) | a);
+
+	file.write((const char *)signature, sizeof(signature));
+	writeChunk(file, "IHDR", header);
+	writeChunk(file, "IDAT", idat);
+	writeChunk(file, "IEND", {});
+}
+
+FrameCapture::FrameCapture(int width, int height, const std::string &directory, CaptureFormat format)
+	: width(width), height(height), directory(directory), format(format), captured(0), written(0)
+{
+	std::filesystem::create_directories(directory);
+
+	glGenFramebuffers(1, &fbo);
+	glGenRenderbuffers(1, &color_rbo);
+	glGenRenderbuffers(1, &depth_rbo);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, color_rbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_rbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_rbo);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "Failed to create capture framebuffer." << std::endl;
+		exit(-1);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenBuffers(CAPTURE_PBO_COUNT, pbos);
+	for (GLuint pbo : pbos)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 3, nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameCapture::~FrameCapture()
+{
+	flush();
+
+	glDeleteBuffers(CAPTURE_PBO_COUNT, pbos);
+	glDeleteRenderbuffers(1, &color_rbo);
+	glDeleteRenderbuffers(1, &depth_rbo);
+	glDeleteFramebuffers(1, &fbo);
+}
+
+void FrameCapture::bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, width, height);
+}
+
+void FrameCapture::capture()
+{
+	if (captured - written == CAPTURE_PBO_COUNT)
+		retire();
+
+	size_t slot = captured % CAPTURE_PBO_COUNT;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, (void *)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	captured++;
+}
+
+void FrameCapture::flush()
+{
+	while (written < captured)
+		retire();
+}
+
+void FrameCapture::retire()
+{
+	size_t slot = written % CAPTURE_PBO_COUNT;
+
+	glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	glDeleteSync(fences[slot]);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+	const unsigned char *pixels = (const unsigned char *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * 3, GL_MAP_READ_BIT);
+
+	if (pixels != nullptr)
+		write(pixels);
+	else
+		std::cerr << "Failed to map captured frame " << written << std::endl;
+
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	written++;
+}
+
+void FrameCapture::write(const unsigned char *pixels)
+{
+	char name[32];
+	std::vector<unsigned char> rgb(width * height * 3);
+
+	snprintf(name, sizeof(name), "frame_%05zu.%s", written, format == Png ? "png" : "ppm");
+
+	// GL rows start at the bottom of the image
+	for (int y = 0; y < height; y++)
+		std::copy(pixels + (height - 1 - y) * width * 3, pixels + (height - y) * width * 3, rgb.begin() + y * width * 3);
+
+	std::ofstream file(std::filesystem::path(directory) / name, std::ios::out | std::ios::binary);
+
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open file " << name << std::endl;
+		return;
+	}
+
+	if (format == Png)
+		writePng(file, width, height, rgb);
+	else
+	{
+		file << "P6\n"
+			 << width << " " << height << "\n255\n";
+		file.write((const char *)rgb.data(), rgb.size());
+	}
+}
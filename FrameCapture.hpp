@@ -0,0 +1,42 @@
+#ifndef FRAMECAPTURE_HPP
+#define FRAMECAPTURE_HPP
+
+#include <string>
+#include <GL/glew.h>
+#include "settings.hpp"
+
+typedef enum CaptureFormat {
+	Png = 0,
+	Ppm
+} CaptureFormat;
+
+// Renders into its own framebuffer and writes every captured frame to an image sequence.
+// Pixels are read back asynchronously into a ring of pixel buffers and only mapped
+// CAPTURE_PBO_COUNT frames later, so capturing never waits on the frame just drawn.
+class FrameCapture
+{
+private:
+	int width;
+	int height;
+	std::string directory;
+	CaptureFormat format;
+
+	GLuint fbo, color_rbo, depth_rbo;
+	GLuint pbos[CAPTURE_PBO_COUNT];
+	GLsync fences[CAPTURE_PBO_COUNT];
+	size_t captured;
+	size_t written;
+
+	void retire();
+	void write(const unsigned char *pixels);
+
+public:
+	FrameCapture(int width, int height, const std::string &directory, CaptureFormat format);
+	~FrameCapture();
+
+	void bind();
+	void capture();
+	void flush();
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include <cmath>
+#include "Frustum.hpp"
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+size_t BoundingSpheres::size() const
+{
+	return x.size();
+}
+
+void BoundingSpheres::resize(size_t count)
+{
+	x.resize(count);
+	y.resize(count);
+	z.resize(count);
+	radius.resize(count);
+}
+
+// Encloses the boxes of bone_count posed bones (16 floats each, see computeWorldTransforms).
+// The unit cube spans [-0.5, 0.5] x [0, 1] x [-0.5, 0.5], so each bone's world box is
+// centered on its transformed (0, 0.5, 0) with half extents the absolute rows scaled by 0.5.
+void BoundingSpheres::fit(size_t index, const float *transforms, size_t bone_count, float margin)
+{
+	float min[3] = {INFINITY, INFINITY, INFINITY};
+	float max[3] = {-INFINITY, -INFINITY, -INFINITY};
+
+	for (size_t bone = 0; bone < bone_count; bone++)
+	{
+		const float *m = &transforms[16 * bone];
+
+		for (size_t c = 0; c < 3; c++)
+		{
+			float center = 0.5f * m[4 + c] + m[12 + c];
+			float extent = 0.5f * (fabsf(m[c]) + fabsf(m[4 + c]) + fabsf(m[8 + c]));
+
+			min[c] = fminf(min[c], center - extent);
+			max[c] = fmaxf(max[c], center + extent);
+		}
+	}
+
+	float half[3];
+
+	for (size_t c = 0; c < 3; c++)
+		half[c] = 0.5f * (max[c] - min[c]);
+
+	x[index] = min[0] + half[0];
+	y[index] = min[1] + half[1];
+	z[index] = min[2] + half[2];
+	radius[index] = sqrtf(half[0] * half[0] + half[1] * half[1] + half[2] * half[2]) + margin;
+}
+
+Frustum::Frustum()
+	: planes()
+{
+}
+
+// Clip space is p * view_projection, so each plane is a sum of two of its columns:
+// left and right from w +- x, bottom and top from w +- y, near and far from w +- z
+Frustum::Frustum(const mat &view_projection)
+{
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		for (size_t side = 0; side < 2; side++)
+		{
+			float *plane = planes[2 * axis + side];
+			float sign = side == 0 ? 1.0f : -1.0f;
+
+			for (size_t row = 0; row < 4; row++)
+				plane[row] = view_projection[row][3] + sign * view_projection[row][axis];
+
+			float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+
+			for (size_t row = 0; row < 4; row++)
+				plane[row] /= length;
+		}
+	}
+}
+
+bool Frustum::contains(float x, float y, float z, float radius) const
+{
+	for (const float *plane : planes)
+		if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < -radius)
+			return false;
+
+	return true;
+}
+
+// Writes 1 into visible for every sphere that intersects the frustum, 0 otherwise,
+// and returns how many do
+size_t Frustum::cull(const BoundingSpheres &spheres, std::vector<uint8_t> &visible) const
+{
+	size_t count = spheres.size();
+	size_t visible_count = 0;
+	size_t i = 0;
+
+	visible.resize(count);
+
+#ifdef __SSE__
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&spheres.x[i]);
+		__m128 y = _mm_loadu_ps(&spheres.y[i]);
+		__m128 z = _mm_loadu_ps(&spheres.z[i]);
+		__m128 radius = _mm_loadu_ps(&spheres.radius[i]);
+		__m128 inside = _mm_cmpeq_ps(radius, radius);
+
+		for (const float *plane : planes)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane[0])), _mm_mul_ps(y, _mm_set1_ps(plane[1]))),
+										 _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane[2])), _mm_set1_ps(plane[3])));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			visible[i + lane] = (mask >> lane) & 1;
+			visible_count += visible[i + lane];
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		visible[i] = contains(spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i]);
+		visible_count += visible[i];
+	}
+
+	return visible_count;
+}
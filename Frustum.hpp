@@ -0,0 +1,37 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <cstdint>
+#include <vector>
+#include "ft_vec.hpp"
+#include "ft_mat.hpp"
+
+typedef ft::matrix<float> mat;
+
+// One sphere per instance, kept as separate arrays so they can be tested four at a time
+struct BoundingSpheres
+{
+	std::vector<float> x, y, z, radius;
+
+	size_t size() const;
+	void resize(size_t count);
+	void fit(size_t index, const float *transforms, size_t bone_count, float margin);
+};
+
+// The six clip planes of a view-projection matrix (row-vector convention, as uploaded
+// to the shaders), normalized so plane distances are in world units.
+// A default constructed frustum contains everything.
+class Frustum
+{
+private:
+	float planes[6][4];
+
+public:
+	Frustum();
+	Frustum(const mat &view_projection);
+
+	bool contains(float x, float y, float z, float radius) const;
+	size_t cull(const BoundingSpheres &spheres, std::vector<uint8_t> &visible) const;
+};
+
+#endif
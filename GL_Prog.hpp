@@ -3,6 +3,10 @@
 #include <sstream>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#ifndef __APPLE__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 class GL_Prog
 {
@@ -11,7 +15,7 @@ public:
             GLFWkeyfun keyCallback, GLFWcursorposfun mouseCallback,
             int width, int height, std::string title = "OpenGL program")
         : window(nullptr), shader_program(0), key_callback(keyCallback), mouse_callback(mouseCallback),
-          screenWidth(width), screenHeight(height)
+          screenWidth(width), screenHeight(height), offscreen(false)
     {
 
         if (!glfwInit())
@@ -61,9 +65,70 @@ public:
         loadShaders(vertexShaderPath, fragmentShaderPath);
     }
 
+    // Windowless context on the Mesa surfaceless platform (llvmpipe when no GPU is present),
+    // for rendering into framebuffer objects on headless machines
+    GL_Prog(const std::string &vertexShaderPath, const std::string &fragmentShaderPath, int width, int height)
+        : window(nullptr), shader_program(0), key_callback(nullptr), mouse_callback(nullptr),
+          screenWidth(width), screenHeight(height), offscreen(true)
+    {
+#ifdef __APPLE__
+        std::cerr << "Offscreen rendering is not supported on this platform." << std::endl;
+        exit(-1);
+#else
+        egl_display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+
+        if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, nullptr, nullptr))
+        {
+            std::cerr << "Failed to initialize EGL." << std::endl;
+            exit(-1);
+        }
+
+        eglBindAPI(EGL_OPENGL_API);
+
+        const EGLint context_attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 0,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE};
+
+        egl_context = eglCreateContext(egl_display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attributes);
+        if (egl_context == EGL_NO_CONTEXT || !eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context))
+        {
+            std::cerr << "Failed to create EGL context." << std::endl;
+            eglTerminate(egl_display);
+            exit(-1);
+        }
+
+        glewExperimental = GL_TRUE;
+        GLenum error = glewInit();
+
+        // GLEW built for GLX complains about the missing X display but loads the entry points anyway
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+        if (error == GLEW_ERROR_NO_GLX_DISPLAY)
+            error = GLEW_OK;
+#endif
+        if (error != GLEW_OK)
+        {
+            std::cerr << "Failed to initialize GLEW." << std::endl;
+            exit(-1);
+        }
+
+        loadShaders(vertexShaderPath, fragmentShaderPath);
+#endif
+    }
+
     ~GL_Prog()
     {
         glDeleteProgram(shader_program);
+#ifndef __APPLE__
+        if (offscreen)
+        {
+            eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(egl_display, egl_context);
+            eglTerminate(egl_display);
+            return;
+        }
+#endif
         glfwTerminate();
     }
 
@@ -73,6 +138,38 @@ public:
         loadShaders(vertexShaderPath, fragmentShaderPath);
     }
 
+    // Extra programs linked from the same kind of shader files, owned by the caller
+    GLuint createProgram(const std::string &vertexShaderPath, const std::string &fragmentShaderPath)
+    {
+        GLuint vertex_shader = createShader(GL_VERTEX_SHADER, loadShaderSource(vertexShaderPath));
+        GLuint fragment_shader = createShader(GL_FRAGMENT_SHADER, loadShaderSource(fragmentShaderPath));
+        GLuint program = glCreateProgram();
+
+        glAttachShader(program, vertex_shader);
+        glAttachShader(program, fragment_shader);
+        glLinkProgram(program);
+        checkShaderError(program, GL_LINK_STATUS, true, "Error: Failed to link shader program.");
+
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+
+        return program;
+    }
+
+    GLuint createComputeProgram(const std::string &computeShaderPath)
+    {
+        GLuint compute_shader = createShader(GL_COMPUTE_SHADER, loadShaderSource(computeShaderPath));
+        GLuint program = glCreateProgram();
+
+        glAttachShader(program, compute_shader);
+        glLinkProgram(program);
+        checkShaderError(program, GL_LINK_STATUS, true, "Error: Failed to link compute program.");
+
+        glDeleteShader(compute_shader);
+
+        return program;
+    }
+
     GLFWwindow *getWindow() const
     {
         return window;
@@ -83,8 +180,16 @@ public:
         return shader_program;
     }
 
+    bool isOffscreen() const
+    {
+        return offscreen;
+    }
+
     int getWidth() const
     {
+        if (offscreen)
+            return screenWidth;
+
         int width, height;
         glfwGetFramebufferSize(window, &width, &height);
         return width;
@@ -92,6 +197,9 @@ public:
 
     int getHeight() const
     {
+        if (offscreen)
+            return screenHeight;
+
         int width, height;
         glfwGetFramebufferSize(window, &width, &height);
         return height;
@@ -104,6 +212,11 @@ private:
     GLFWcursorposfun mouse_callback;
     int screenWidth;
     int screenHeight;
+    bool offscreen;
+#ifndef __APPLE__
+    EGLDisplay egl_display;
+    EGLContext egl_context;
+#endif
 
     static void error_callback([[maybe_unused]] int error, const char *description)
     {
@@ -112,20 +225,7 @@ private:
 
     void loadShaders(const std::string &vertexShaderPath, const std::string &fragmentShaderPath)
     {
-        std::string vertexShaderSource = loadShaderSource(vertexShaderPath);
-        std::string fragmentShaderSource = loadShaderSource(fragmentShaderPath);
-
-        GLuint vertex_shader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
-        GLuint fragment_shader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-
-        shader_program = glCreateProgram();
-        glAttachShader(shader_program, vertex_shader);
-        glAttachShader(shader_program, fragment_shader);
-        glLinkProgram(shader_program);
-        checkShaderError(shader_program, GL_LINK_STATUS, true, "Error: Failed to link shader program.");
-
-        glDeleteShader(vertex_shader);
-        glDeleteShader(fragment_shader);
+        shader_program = createProgram(vertexShaderPath, fragmentShaderPath);
     }
 
     std::string loadShaderSource(const std::string &filePath)
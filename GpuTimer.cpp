@@ -0,0 +1,120 @@
+#include <algorithm>
+#include "GpuTimer.hpp"
+#include "Profiler.hpp"
+
+const char *getGpuPassName(GpuPass pass)
+{
+	const char *names[GpuPassCount] = {"poses", "scene", "imgui"};
+
+	return pass < GpuPassCount ? names[pass] : "unknown";
+}
+
+GpuTimer::GpuTimer()
+	: supported(GLEW_VERSION_3_3 || GLEW_ARB_timer_query), queries(), issued(), frame(0), active(-1), frame_count(0), next(0),
+	  times(PROFILER_HISTORY * GpuPassCount, 0.0f), dropped(0)
+{
+	if (supported)
+		glGenQueries(GPU_TIMER_LATENCY * GpuPassCount, &queries[0][0]);
+}
+
+GpuTimer::~GpuTimer()
+{
+	if (supported)
+		glDeleteQueries(GPU_TIMER_LATENCY * GpuPassCount, &queries[0][0]);
+}
+
+bool GpuTimer::isSupported() const
+{
+	return supported;
+}
+
+void GpuTimer::begin(GpuPass pass)
+{
+	if (!supported || active >= 0 || !profiler.isEnabled())
+		return;
+
+	size_t slot = frame % GPU_TIMER_LATENCY;
+
+	glBeginQuery(GL_TIME_ELAPSED, queries[slot][pass]);
+	issued[slot][pass] = true;
+	active = pass;
+}
+
+void GpuTimer::end()
+{
+	if (active < 0)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	active = -1;
+}
+
+// Moves on to the next slot of the ring, reading back the frame that used it last
+void GpuTimer::endFrame()
+{
+	if (!supported)
+		return;
+
+	frame++;
+	collect(frame % GPU_TIMER_LATENCY, frame > GPU_TIMER_LATENCY);
+}
+
+// A frame is only recorded once every pass it timed is available. The first frame is left out
+// like it is by the profiler: it also pays for warming the driver up, and some drivers report
+// the time since they started for the first query.
+void GpuTimer::collect(size_t slot, bool record)
+{
+	float frame_times[GpuPassCount] = {};
+	bool any = false;
+	bool complete = true;
+
+	for (size_t pass = 0; pass < GpuPassCount; pass++)
+	{
+		if (!issued[slot][pass])
+			continue;
+
+		GLuint available = GL_FALSE;
+		GLuint64 elapsed = 0;
+
+		issued[slot][pass] = false;
+		glGetQueryObjectuiv(queries[slot][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			complete = false;
+			continue;
+		}
+
+		glGetQueryObjectui64v(queries[slot][pass], GL_QUERY_RESULT, &elapsed);
+		frame_times[pass] = elapsed / 1e6f;
+		any = true;
+	}
+
+	if (!complete)
+		dropped++;
+	if (!any || !complete || !record)
+		return;
+
+	std::copy(frame_times, frame_times + GpuPassCount, &times[next * GpuPassCount]);
+	next = (next + 1) % PROFILER_HISTORY;
+	frame_count = std::min(frame_count + 1, (size_t)PROFILER_HISTORY);
+}
+
+size_t GpuTimer::getFrameCount() const
+{
+	return frame_count;
+}
+
+size_t GpuTimer::getDropped() const
+{
+	return dropped;
+}
+
+float GpuTimer::getAverage(GpuPass pass) const
+{
+	float sum = 0.0f;
+
+	for (size_t i = 0; i < frame_count; i++)
+		sum += times[i * GpuPassCount + pass];
+
+	return frame_count > 0 ? sum / frame_count : 0.0f;
+}
@@ -0,0 +1,53 @@
+#ifndef GPUTIMER_HPP
+#define GPUTIMER_HPP
+
+#include <vector>
+#include <GL/glew.h>
+#include "settings.hpp"
+
+typedef enum GpuPass {
+	PosePass = 0, // compute shader pose evaluation
+	ScenePass,	  // clear and bones
+	ImGuiPass,
+	GpuPassCount
+} GpuPass;
+
+const char *getGpuPassName(GpuPass pass);
+
+// GPU time of each render pass, measured with GL_TIME_ELAPSED queries (GL 3.3+) while the
+// profiler is enabled. Queries go round a ring of GPU_TIMER_LATENCY frames and a frame's
+// results are only read when its slot comes back around; results that are still not
+// available then are dropped rather than waited for, so timing never stalls the pipeline.
+// Passes cannot nest, a GL context only runs one elapsed time query at a time.
+class GpuTimer
+{
+private:
+	bool supported;
+	GLuint queries[GPU_TIMER_LATENCY][GpuPassCount];
+	bool issued[GPU_TIMER_LATENCY][GpuPassCount];
+	size_t frame;
+	int active; // pass being timed, -1 for none
+
+	size_t frame_count; // recorded in the history, up to PROFILER_HISTORY
+	size_t next;
+	std::vector<float> times; // milliseconds, PROFILER_HISTORY per pass
+	size_t dropped;
+
+	void collect(size_t slot, bool record);
+
+public:
+	GpuTimer();
+	~GpuTimer();
+
+	bool isSupported() const;
+
+	void begin(GpuPass pass);
+	void end();
+	void endFrame();
+
+	size_t getFrameCount() const;
+	size_t getDropped() const;
+	float getAverage(GpuPass pass) const;
+};
+
+#endif
@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <cmath>
+#include "InverseKinematics.hpp"
+#include "settings.hpp"
+
+// radians a straight joint is bent by when pointing the end at the target cannot shorten the chain
+#define STRAIGHT_BEND 0.1f
+
+// Rotations are 3x3, row-major and applied to row vectors like the world transforms:
+// v' = v R, so R_child_world = R_child_local * R_parent_world.
+
+static const float identity[9] = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+
+const char *getIkSolverName(IkSolver solver)
+{
+	const char *names[IkSolverCount] = {"two-bone", "ccd", "fabrik"};
+
+	return solver < IkSolverCount ? names[solver] : "unknown";
+}
+
+static void getRotation(const vec &euler, float *rotation)
+{
+	mat m = eulerToRotation(euler, 3);
+
+	for (size_t i = 0; i < 3; i++)
+		for (size_t j = 0; j < 3; j++)
+			rotation[3 * i + j] = m[i][j];
+}
+
+static void multiply(const float *a, const float *b, float *out)
+{
+	for (size_t i = 0; i < 3; i++)
+		for (size_t j = 0; j < 3; j++)
+			out[3 * i + j] = a[3 * i] * b[j] + a[3 * i + 1] * b[3 + j] + a[3 * i + 2] * b[6 + j];
+}
+
+static void transform(const float *v, const float *rotation, float *out)
+{
+	for (size_t j = 0; j < 3; j++)
+		out[j] = v[0] * rotation[j] + v[1] * rotation[3 + j] + v[2] * rotation[6 + j];
+}
+
+static float dot(const float *a, const float *b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void cross(const float *a, const float *b, float *out)
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Turns vectors by angle around the unit axis, counterclockwise looking down the axis
+static void getAxisAngle(const float *axis, float angle, float *rotation)
+{
+	float c = cosf(angle);
+	float s = sinf(angle);
+	float skew[9] = {0.0f, -axis[2], axis[1], axis[2], 0.0f, -axis[0], -axis[1], axis[0], 0.0f};
+
+	for (size_t i = 0; i < 3; i++)
+		for (size_t j = 0; j < 3; j++)
+			rotation[3 * i + j] = (i == j ? c : 0.0f) + (1.0f - c) * axis[i] * axis[j] - s * skew[3 * i + j];
+}
+
+// Shortest arc taking the direction of from onto the direction of to, false when they are aligned
+static bool getRotationBetween(const float *from, const float *to, float *rotation)
+{
+	float axis[3];
+
+	cross(from, to, axis);
+
+	float sine = sqrtf(dot(axis, axis));
+
+	if (sine <= 1e-6f * sqrtf(dot(from, from) * dot(to, to)))
+		return false;
+
+	for (size_t c = 0; c < 3; c++)
+		axis[c] /= sine;
+	getAxisAngle(axis, atan2f(sine, dot(from, to)), rotation);
+
+	return true;
+}
+
+static void getWorldFrame(const Skeleton &skeleton, const std::vector<Animation> &locals, const vec &offset, size_t bone,
+						  float *rotation, float *position)
+{
+	int parent = skeleton.parents[bone];
+	vec translation = locals[bone].getTranslation();
+	float local[9];
+
+	getRotation(locals[bone].getRotation(), local);
+
+	if (parent < 0)
+	{
+		std::copy(local, local + 9, rotation);
+		for (size_t c = 0; c < 3; c++)
+			position[c] = translation[c] + offset[c];
+		return;
+	}
+
+	float parent_rotation[9];
+	float parent_position[3];
+	vec parent_scale = locals[parent].getScale();
+	float joint[3] = {translation[0] * parent_scale[0], translation[1] * parent_scale[1], translation[2] * parent_scale[2]};
+
+	getWorldFrame(skeleton, locals, offset, parent, parent_rotation, parent_position);
+	transform(joint, parent_rotation, position);
+	for (size_t c = 0; c < 3; c++)
+		position[c] += parent_position[c];
+	multiply(local, parent_rotation, rotation);
+}
+
+// World frames of the bones of a chain, solved in place
+struct ChainPose
+{
+	std::vector<float> rotations; // 9 per bone
+	std::vector<float> positions; // 3 per bone, of its joint
+	float parent[9];			  // world rotation above the chain, identity for the root
+	float end[3];
+};
+
+static ChainPose getChainPose(const Skeleton &skeleton, const std::vector<Animation> &locals, const vec &offset, const IkChain &chain)
+{
+	ChainPose pose;
+	size_t count = chain.bones.size();
+	int parent = skeleton.parents[chain.bones[0]];
+	vec end_scale = locals[chain.bones.back()].getScale();
+	float end[3] = {0.0f, end_scale[1], 0.0f};
+
+	pose.rotations.resize(9 * count);
+	pose.positions.resize(3 * count);
+
+	if (parent < 0)
+		std::copy(identity, identity + 9, pose.parent);
+	else
+	{
+		float position[3];
+
+		getWorldFrame(skeleton, locals, offset, parent, pose.parent, position);
+	}
+
+	getWorldFrame(skeleton, locals, offset, chain.bones[0], &pose.rotations[0], &pose.positions[0]);
+	for (size_t i = 1; i < count; i++)
+	{
+		vec translation = locals[chain.bones[i]].getTranslation();
+		vec parent_scale = locals[chain.bones[i - 1]].getScale();
+		float joint[3] = {translation[0] * parent_scale[0], translation[1] * parent_scale[1], translation[2] * parent_scale[2]};
+		float local[9];
+
+		transform(joint, &pose.rotations[9 * (i - 1)], &pose.positions[3 * i]);
+		for (size_t c = 0; c < 3; c++)
+			pose.positions[3 * i + c] += pose.positions[3 * (i - 1) + c];
+		getRotation(locals[chain.bones[i]].getRotation(), local);
+		multiply(local, &pose.rotations[9 * (i - 1)], &pose.rotations[9 * i]);
+	}
+
+	transform(end, &pose.rotations[9 * (count - 1)], pose.end);
+	for (size_t c = 0; c < 3; c++)
+		pose.end[c] += pose.positions[3 * (count - 1) + c];
+
+	return pose;
+}
+
+// Turns bone first and everything below it around its joint
+static void rotateChain(ChainPose &pose, size_t first, const float *rotation)
+{
+	const float *pivot = &pose.positions[3 * first];
+	size_t count = pose.rotations.size() / 9;
+	float turned[9];
+	float arm[3];
+
+	for (size_t i = first; i < count; i++)
+	{
+		multiply(&pose.rotations[9 * i], rotation, turned);
+		std::copy(turned, turned + 9, &pose.rotations[9 * i]);
+	}
+
+	for (size_t i = first + 1; i <= count; i++)
+	{
+		float *position = i < count ? &pose.positions[3 * i] : pose.end;
+
+		for (size_t c = 0; c < 3; c++)
+			arm[c] = position[c] - pivot[c];
+		transform(arm, rotation, position);
+		for (size_t c = 0; c < 3; c++)
+			position[c] += pivot[c];
+	}
+}
+
+// Sets the angle at the middle joint from the law of cosines, then swings the whole chain onto the target
+static void solveTwoBone(ChainPose &pose, const float *target, const float *bend_axis)
+{
+	const float *a = &pose.positions[0];
+	const float *b = &pose.positions[3];
+	float ba[3], bc[3], at[3], ac[3], axis[3], rotation[9];
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		ba[c] = a[c] - b[c];
+		bc[c] = pose.end[c] - b[c];
+		at[c] = target[c] - a[c];
+	}
+
+	float lab = sqrtf(dot(ba, ba));
+	float lcb = sqrtf(dot(bc, bc));
+
+	if (lab <= 0.0f || lcb <= 0.0f)
+		return;
+
+	float lat = std::fmax(fabsf(lab - lcb) + IK_TOLERANCE, std::fmin(sqrtf(dot(at, at)), lab + lcb - IK_TOLERANCE));
+	float current = acosf(std::fmax(-1.0f, std::fmin(dot(ba, bc) / (lab * lcb), 1.0f)));
+	float wanted = acosf(std::fmax(-1.0f, std::fmin((lab * lab + lcb * lcb - lat * lat) / (2.0f * lab * lcb), 1.0f)));
+
+	// a straight chain bends the way its middle bone is allowed to
+	cross(ba, bc, axis);
+
+	float length = sqrtf(dot(axis, axis));
+
+	if (length <= 1e-6f * lab * lcb)
+		std::copy(bend_axis, bend_axis + 3, axis);
+	else
+		for (size_t c = 0; c < 3; c++)
+			axis[c] /= length;
+
+	getAxisAngle(axis, wanted - current, rotation);
+	rotateChain(pose, 1, rotation);
+
+	for (size_t c = 0; c < 3; c++)
+		ac[c] = pose.end[c] - a[c];
+	if (getRotationBetween(ac, at, rotation))
+		rotateChain(pose, 0, rotation);
+}
+
+// Cyclic coordinate descent: each joint in turn, from the last one up, points the end at the target.
+// Straight joints are bent around their own x axis first, like the two-bone solver does.
+static void solveCcd(ChainPose &pose, const float *target)
+{
+	size_t count = pose.rotations.size() / 9;
+	float rotation[9];
+
+	for (size_t iteration = 0; iteration < IK_CCD_ITERATIONS; iteration++)
+	{
+		for (size_t i = count; i-- > 0;)
+		{
+			const float *joint = &pose.positions[3 * i];
+			float to_end[3], to_target[3];
+
+			for (size_t c = 0; c < 3; c++)
+			{
+				to_end[c] = pose.end[c] - joint[c];
+				to_target[c] = target[c] - joint[c];
+			}
+			if (getRotationBetween(to_end, to_target, rotation))
+				rotateChain(pose, i, rotation);
+			else if (i > 0 && dot(to_target, to_target) < dot(to_end, to_end))
+			{
+				float axis[3] = {pose.rotations[9 * i], pose.rotations[9 * i + 1], pose.rotations[9 * i + 2]};
+
+				getAxisAngle(axis, STRAIGHT_BEND, rotation);
+				rotateChain(pose, i, rotation);
+			}
+		}
+
+		float miss[3] = {pose.end[0] - target[0], pose.end[1] - target[1], pose.end[2] - target[2]};
+
+		if (dot(miss, miss) <= IK_TOLERANCE * IK_TOLERANCE)
+			break;
+	}
+}
+
+// Moves joint to length away from anchor, on the line between them
+static void placeJoint(float *joint, const float *anchor, float length)
+{
+	float direction[3] = {joint[0] - anchor[0], joint[1] - anchor[1], joint[2] - anchor[2]};
+	float distance = sqrtf(dot(direction, direction));
+
+	if (distance <= 0.0f)
+		return;
+
+	for (size_t c = 0; c < 3; c++)
+		joint[c] = anchor[c] + direction[c] * length / distance;
+}
+
+// Forward and backward reaching: the joints are moved along the bones, keeping their lengths, from the
+// target up and then from the root down. Straight joints are bent first, since moving along a straight
+// line never bends it. The bones are then turned, from the root down, onto where their joints ended up.
+static void solveFabrik(ChainPose &pose, const float *target)
+{
+	size_t count = pose.rotations.size() / 9;
+	std::vector<float> joints(3 * (count + 1));
+	std::vector<float> lengths(count);
+	float rotation[9];
+
+	for (size_t i = 1; i < count; i++)
+	{
+		float before[3], after[3], axis[3], to_target[3];
+		const float *next = i + 1 < count ? &pose.positions[3 * (i + 1)] : pose.end;
+
+		for (size_t c = 0; c < 3; c++)
+		{
+			before[c] = pose.positions[3 * i + c] - pose.positions[3 * (i - 1) + c];
+			after[c] = next[c] - pose.positions[3 * i + c];
+			to_target[c] = target[c] - pose.positions[c];
+		}
+		cross(before, after, axis);
+		if (dot(axis, axis) > 1e-12f * dot(before, before) * dot(after, after))
+			continue;
+
+		float span[3] = {pose.end[0] - pose.positions[0], pose.end[1] - pose.positions[1], pose.end[2] - pose.positions[2]};
+
+		if (dot(to_target, to_target) >= dot(span, span))
+			continue;
+
+		float x[3] = {pose.rotations[9 * i], pose.rotations[9 * i + 1], pose.rotations[9 * i + 2]};
+
+		getAxisAngle(x, STRAIGHT_BEND, rotation);
+		rotateChain(pose, i, rotation);
+	}
+
+	std::copy(pose.positions.begin(), pose.positions.end(), joints.begin());
+	std::copy(pose.end, pose.end + 3, &joints[3 * count]);
+	for (size_t i = 0; i < count; i++)
+	{
+		float bone[3] = {joints[3 * (i + 1)] - joints[3 * i], joints[3 * (i + 1) + 1] - joints[3 * i + 1],
+						 joints[3 * (i + 1) + 2] - joints[3 * i + 2]};
+
+		lengths[i] = sqrtf(dot(bone, bone));
+	}
+
+	for (size_t iteration = 0; iteration < IK_FABRIK_ITERATIONS; iteration++)
+	{
+		float miss[3] = {joints[3 * count] - target[0], joints[3 * count + 1] - target[1], joints[3 * count + 2] - target[2]};
+
+		if (dot(miss, miss) <= IK_TOLERANCE * IK_TOLERANCE)
+			break;
+
+		std::copy(target, target + 3, &joints[3 * count]);
+		for (size_t i = count; i-- > 0;)
+			placeJoint(&joints[3 * i], &joints[3 * (i + 1)], lengths[i]);
+
+		std::copy(pose.positions.begin(), pose.positions.begin() + 3, joints.begin());
+		for (size_t i = 0; i < count; i++)
+			placeJoint(&joints[3 * (i + 1)], &joints[3 * i], lengths[i]);
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const float *next = i + 1 < count ? &pose.positions[3 * (i + 1)] : pose.end;
+		float from[3], to[3];
+
+		for (size_t c = 0; c < 3; c++)
+		{
+			from[c] = next[c] - pose.positions[3 * i + c];
+			to[c] = joints[3 * (i + 1) + c] - pose.positions[3 * i + c];
+		}
+		if (getRotationBetween(from, to, rotation))
+			rotateChain(pose, i, rotation);
+	}
+}
+
+IkChain getIkChain(const Skeleton &skeleton, const std::vector<std::string> &names, IkSolver solver)
+{
+	IkChain chain;
+
+	chain.solver = solver;
+
+	for (const std::string &name : names)
+	{
+		auto it = std::find(skeleton.names.begin(), skeleton.names.end(), name);
+		size_t bone = it - skeleton.names.begin();
+
+		if (it == skeleton.names.end() || (!chain.bones.empty() && skeleton.parents[bone] != (int)chain.bones.back()))
+			return IkChain{{}, solver};
+
+		chain.bones.push_back(bone);
+	}
+
+	return chain;
+}
+
+void getChainEnd(const Skeleton &skeleton, const std::vector<Animation> &locals, const vec &offset, const IkChain &chain, float *end)
+{
+	ChainPose pose = getChainPose(skeleton, locals, offset, chain);
+
+	std::copy(pose.end, pose.end + 3, end);
+}
+
+void solveIk(const Skeleton &skeleton, std::vector<Animation> &locals, const vec &offset, const IkChain &chain, const float *target)
+{
+	if (chain.bones.empty())
+		return;
+
+	ChainPose pose = getChainPose(skeleton, locals, offset, chain);
+
+	// the analytic solver only exists for two bones
+	if (chain.solver == TwoBone && chain.bones.size() == 2)
+		solveTwoBone(pose, target, &pose.rotations[9]);
+	else if (chain.solver == Fabrik)
+		solveFabrik(pose, target);
+	else
+		solveCcd(pose, target);
+
+	for (size_t i = 0; i < chain.bones.size(); i++)
+	{
+		const float *parent = i > 0 ? &pose.rotations[9 * (i - 1)] : pose.parent;
+		const float *world = &pose.rotations[9 * i];
+		Animation &animation = locals[chain.bones[i]];
+		mat local(3, 3);
+
+		// the local rotation is the world one with the parent's undone, and a rotation's inverse is its transpose
+		for (size_t r = 0; r < 3; r++)
+			for (size_t c = 0; c < 3; c++)
+				local[r][c] = world[3 * r] * parent[3 * c] + world[3 * r + 1] * parent[3 * c + 1] + world[3 * r + 2] * parent[3 * c + 2];
+
+		animation = Animation(animation.getTranslation(), rotationToEuler(local), animation.getScale(), animation.getColor());
+	}
+}
@@ -0,0 +1,33 @@
+#ifndef INVERSEKINEMATICS_HPP
+#define INVERSEKINEMATICS_HPP
+
+#include "Skeleton.hpp"
+
+typedef enum IkSolver {
+	TwoBone = 0, // analytic, bends the chain in the plane it already bends in
+	Ccd,		 // iterative, rotates each joint toward the target from the end of the chain up
+	Fabrik,		 // iterative, drags the joints onto the target and back onto the root, then turns the bones to follow
+	IkSolverCount
+} IkSolver;
+
+const char *getIkSolverName(IkSolver solver);
+
+// Bones from the root of the chain down, each the parent of the next. The end of the chain
+// is the far end of its last bone, where its first child would be.
+struct IkChain
+{
+	std::vector<size_t> bones;
+	IkSolver solver;
+};
+
+// Empty when the skeleton lacks one of the bones or they do not form a chain
+IkChain getIkChain(const Skeleton &skeleton, const std::vector<std::string> &names, IkSolver solver);
+
+// World position of the end of the chain for an instance placed at offset
+void getChainEnd(const Skeleton &skeleton, const std::vector<Animation> &locals, const vec &offset, const IkChain &chain, float *end);
+
+// Rewrites the local rotations of the chain so that its end reaches target, or gets as close
+// as the bone lengths allow. Translations, scales and everything outside the chain are kept.
+void solveIk(const Skeleton &skeleton, std::vector<Animation> &locals, const vec &offset, const IkChain &chain, const float *target);
+
+#endif
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cmath>
+#include "PoseBlender.hpp"
+
+PoseBlender::PoseBlender() : fade_elapsed(0.0f), fade_duration(0.0f)
+{
+}
+
+bool PoseBlender::isActive() const
+{
+	if (fading.isPlaying())
+		return true;
+
+	for (const BlendLayer &layer : layers)
+		if (layer.playback.isPlaying())
+			return true;
+
+	return false;
+}
+
+// Keeps playing from where it was, fading out over duration seconds
+void PoseBlender::crossfade(const Playback &from, float duration)
+{
+	if (!from.isPlaying() || duration <= 0.0f)
+		return stopFade();
+
+	// a clip that ends while fading out holds its last pose
+	fading = from;
+	if (fading.mode == Once)
+		fading.setMode(Clamp);
+	fade_elapsed = 0.0f;
+	fade_duration = duration;
+}
+
+void PoseBlender::stopFade()
+{
+	fading.stop();
+	fade_elapsed = 0.0f;
+}
+
+void PoseBlender::addLayer(const BlendLayer &layer)
+{
+	layers.push_back(layer);
+}
+
+void PoseBlender::setLayerWeight(size_t index, float weight)
+{
+	if (index < layers.size())
+		layers[index].weight = std::fmax(0.0f, std::fmin(weight, 1.0f));
+}
+
+void PoseBlender::clearLayers()
+{
+	layers.clear();
+}
+
+void PoseBlender::step(float dt)
+{
+	if (fading.isPlaying())
+	{
+		fading.step(dt);
+		fade_elapsed += dt;
+		if (fade_elapsed >= fade_duration)
+			stopFade();
+	}
+
+	for (BlendLayer &layer : layers)
+		layer.playback.step(dt);
+}
+
+// Blends the faded out clip and the layers into the pose of the instance's own playback,
+// sampled alpha of the way into the next step like it
+void PoseBlender::blend(float *channels, size_t bone_count, float alpha, float dt)
+{
+	size_t count = 12 * bone_count;
+
+	scratch.resize(count);
+
+	if (fading.isPlaying())
+	{
+		float weight = std::fmin((fade_elapsed + alpha * dt) / fade_duration, 1.0f);
+
+		fading.sample(fading.sampleTime(alpha, dt), scratch.data());
+		for (size_t i = 0; i < count; i++)
+			channels[i] = scratch[i] + (channels[i] - scratch[i]) * weight;
+	}
+
+	for (const BlendLayer &layer : layers)
+	{
+		if (!layer.playback.isPlaying() || layer.weight <= 0.0f)
+			continue;
+
+		const BoneMask *mask = layer.mask.get();
+		const float *reference = layer.reference->data();
+
+		layer.playback.sample(layer.playback.sampleTime(alpha, dt), scratch.data(), mask);
+		for (size_t bone = 0; bone < bone_count; bone++)
+		{
+			if (mask != nullptr && !mask->test(bone))
+				continue;
+
+			for (size_t i = 12 * bone; i < 12 * bone + 12; i++)
+			{
+				if (layer.additive)
+					channels[i] += (scratch[i] - reference[i]) * layer.weight;
+				else
+					channels[i] += (scratch[i] - channels[i]) * layer.weight;
+			}
+		}
+	}
+}
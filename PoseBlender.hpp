@@ -0,0 +1,43 @@
+#ifndef POSEBLENDER_HPP
+#define POSEBLENDER_HPP
+
+#include "Clock.hpp"
+
+// A clip played on top of an instance's own playback
+struct BlendLayer
+{
+	Playback playback;
+	float weight;
+	bool additive;										 // adds the difference to its first key instead of blending toward it
+	std::shared_ptr<const std::vector<float>> reference; // first key, flat
+	std::shared_ptr<const BoneMask> mask;				 // bones the layer drives, nullptr for all of them
+};
+
+// Crossfade and layers of one instance. Everything is blended on flat poses of 12 floats
+// per bone (see flattenPose), into a single scratch buffer reused for every layer.
+class PoseBlender
+{
+private:
+	Playback fading; // the clip faded out
+	float fade_elapsed;
+	float fade_duration;
+	std::vector<BlendLayer> layers;
+	std::vector<float> scratch;
+
+public:
+	PoseBlender();
+
+	bool isActive() const;
+
+	void crossfade(const Playback &from, float duration);
+	void stopFade();
+
+	void addLayer(const BlendLayer &layer);
+	void setLayerWeight(size_t index, float weight);
+	void clearLayers();
+
+	void step(float dt);
+	void blend(float *channels, size_t bone_count, float alpha, float dt);
+};
+
+#endif
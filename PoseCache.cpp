@@ -0,0 +1,138 @@
+#include <cmath>
+#include "PoseCache.hpp"
+#include "settings.hpp"
+
+size_t BakedClip::bytes() const
+{
+	return sizeof(BakedClip) + (transforms.capacity() + colors.capacity()) * sizeof(float);
+}
+
+// Lerps the two baked frames around t, then moves the root from the origin to offset.
+// Baked matrices are affine with the translation in the last row, so the offset is
+// simply added to it.
+void BakedClip::sample(float t, const vec &offset, float *transforms, float *colors) const
+{
+	float f = std::fmax(0.0f, t) * rate;
+	size_t first = std::min((size_t)f, frame_count - 1);
+	size_t second = std::min(first + 1, frame_count - 1);
+	float start = first / rate;
+	float end = std::fmin(second / rate, duration);
+	float alpha = end > start ? std::fmin((t - start) / (end - start), 1.0f) : 0.0f;
+
+	const float *m0 = &this->transforms[first * bone_count * 16];
+	const float *m1 = &this->transforms[second * bone_count * 16];
+	const float *c0 = &this->colors[first * bone_count * 3];
+	const float *c1 = &this->colors[second * bone_count * 3];
+
+	for (size_t i = 0; i < bone_count * 16; i++)
+		transforms[i] = m0[i] + (m1[i] - m0[i]) * alpha;
+
+	for (size_t i = 0; i < bone_count * 3; i++)
+		colors[i] = c0[i] + (c1[i] - c0[i]) * alpha;
+
+	for (size_t bone = 0; bone < bone_count; bone++)
+		for (size_t c = 0; c < 3; c++)
+			transforms[bone * 16 + 12 + c] += offset[c];
+}
+
+std::shared_ptr<const BakedClip> bakeClip(const Skeleton &skeleton, const Animations &clip, float rate)
+{
+	std::shared_ptr<BakedClip> baked = std::make_shared<BakedClip>();
+	vec origin(3);
+
+	baked->rate = rate;
+	baked->duration = clip.rbegin()->first;
+	baked->bone_count = skeleton.size();
+	baked->frame_count = (size_t)ceil(baked->duration * rate) + 1;
+	baked->transforms.resize(baked->frame_count * baked->bone_count * 16);
+	baked->colors.resize(baked->frame_count * baked->bone_count * 3);
+
+	for (size_t frame = 0; frame < baked->frame_count; frame++)
+	{
+		float t = std::fmin(frame / rate, baked->duration);
+		std::vector<Animation> locals = sampleAnimations(clip, t);
+
+		computeWorldTransforms(skeleton, locals, origin, &baked->transforms[frame * baked->bone_count * 16]);
+
+		for (size_t bone = 0; bone < baked->bone_count; bone++)
+		{
+			const vec color = locals[bone].getColor();
+
+			for (size_t c = 0; c < 3; c++)
+				baked->colors[(frame * baked->bone_count + bone) * 3 + c] = color[c];
+		}
+	}
+
+	return baked;
+}
+
+PoseCache::PoseCache() : rate(POSE_CACHE_RATE), enabled(false)
+{
+}
+
+void PoseCache::bake(const Skeleton &skeleton, const std::map<std::string, Animations> &animations)
+{
+	clips.clear();
+
+	// a single keyframe cannot be played, same as in the editor
+	for (const auto &[name, clip] : animations)
+		if (clip.size() > 1)
+			clips[name] = bakeClip(skeleton, clip, rate);
+}
+
+void PoseCache::invalidate(const std::string &name)
+{
+	clips.erase(name);
+}
+
+void PoseCache::clear()
+{
+	clips.clear();
+}
+
+std::shared_ptr<const BakedClip> PoseCache::get(const std::string &name) const
+{
+	auto it = clips.find(name);
+
+	if (!enabled || it == clips.end())
+		return nullptr;
+
+	return it->second;
+}
+
+const std::map<std::string, std::shared_ptr<const BakedClip>> &PoseCache::getClips() const
+{
+	return clips;
+}
+
+size_t PoseCache::bytes() const
+{
+	size_t total = 0;
+
+	for (const auto &[name, clip] : clips)
+		total += clip->bytes();
+
+	return total;
+}
+
+float PoseCache::getRate() const
+{
+	return rate;
+}
+
+// Already baked clips keep their rate until they are baked again
+void PoseCache::setRate(float rate)
+{
+	if (rate > 0.0f)
+		this->rate = rate;
+}
+
+bool PoseCache::isEnabled() const
+{
+	return enabled;
+}
+
+void PoseCache::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+}
@@ -0,0 +1,50 @@
+#ifndef POSECACHE_HPP
+#define POSECACHE_HPP
+
+#include <memory>
+#include <string>
+#include "Skeleton.hpp"
+
+// World matrices and colors of every bone of a clip, sampled at a fixed rate and
+// stored frame after frame with the root at the origin
+struct BakedClip
+{
+	float rate;
+	float duration;
+	size_t frame_count;
+	size_t bone_count;
+	std::vector<float> transforms; // 16 floats per bone per frame
+	std::vector<float> colors;	   // 3 floats per bone per frame
+
+	size_t bytes() const;
+	void sample(float t, const vec &offset, float *transforms, float *colors) const;
+};
+
+std::shared_ptr<const BakedClip> bakeClip(const Skeleton &skeleton, const Animations &clip, float rate);
+
+// Baked versions of the loaded clips, looked up by name at play time
+class PoseCache
+{
+private:
+	std::map<std::string, std::shared_ptr<const BakedClip>> clips;
+	float rate;
+	bool enabled;
+
+public:
+	PoseCache();
+
+	void bake(const Skeleton &skeleton, const std::map<std::string, Animations> &animations);
+	void invalidate(const std::string &name);
+	void clear();
+
+	std::shared_ptr<const BakedClip> get(const std::string &name) const;
+	const std::map<std::string, std::shared_ptr<const BakedClip>> &getClips() const;
+	size_t bytes() const;
+
+	float getRate() const;
+	void setRate(float rate);
+	bool isEnabled() const;
+	void setEnabled(bool enabled);
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "PoseCompute.hpp"
+#include "settings.hpp"
+
+// 4 vec4 per bone: translation, rotation, scale, color
+static void appendKey(std::vector<float> &keys, const std::vector<Animation> &pose)
+{
+	for (const Animation &animation : pose)
+	{
+		for (const vec &channel : {animation.getTranslation(), animation.getRotation(), animation.getScale(), animation.getColor()})
+		{
+			for (size_t c = 0; c < 3; c++)
+				keys.push_back(channel[c]);
+			keys.push_back(0.0f);
+		}
+	}
+}
+
+bool PoseCompute::isSupported(const std::vector<Skeleton> &rigs)
+{
+	bool compute = GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object);
+
+	for (const Skeleton &rig : rigs)
+		if (rig.size() > POSE_COMPUTE_MAX_BONES)
+			return false;
+
+	return compute;
+}
+
+PoseCompute::PoseCompute(GLuint program, const std::vector<Skeleton> &rigs)
+	: program(program), capacity(0), rigs(rigs)
+{
+	GLuint buffers[6];
+	std::vector<GLint> parents;
+
+	glGenBuffers(6, buffers);
+	transforms_ssbo = buffers[0];
+	colors_ssbo = buffers[1];
+	instances_ssbo = buffers[2];
+	key_times_ssbo = buffers[3];
+	keys_ssbo = buffers[4];
+	parents_ssbo = buffers[5];
+
+	for (const Skeleton &rig : rigs)
+	{
+		first_parents.push_back(parents.size());
+		parents.insert(parents.end(), rig.parents.begin(), rig.parents.end());
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, parents_ssbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, parents.size() * sizeof(GLint), parents.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	uploadClips({}, rigs[0].bind_pose);
+}
+
+PoseCompute::~PoseCompute()
+{
+	GLuint buffers[] = {transforms_ssbo, colors_ssbo, instances_ssbo, key_times_ssbo, keys_ssbo, parents_ssbo};
+
+	glDeleteBuffers(6, buffers);
+	glDeleteProgram(program);
+}
+
+// Clips only change when a new one starts playing, so they are all uploaded again together.
+// The rest poses come first and share the time at index 0.
+void PoseCompute::uploadClips(const std::vector<std::shared_ptr<const Animations>> &clips, const std::vector<Animation> &rest)
+{
+	std::vector<float> key_times = {0.0f};
+	std::vector<float> keys;
+
+	rest_keys.clear();
+	for (size_t rig = 0; rig < rigs.size(); rig++)
+	{
+		rest_keys.push_back(keys.size() / 4);
+		appendKey(keys, rig == 0 ? rest : rigs[rig].bind_pose);
+	}
+
+	resident = clips;
+	first_times.clear();
+	first_keys.clear();
+
+	for (const std::shared_ptr<const Animations> &clip : resident)
+	{
+		first_times.push_back(key_times.size());
+		first_keys.push_back(keys.size() / 4);
+
+		for (const auto &[time, pose] : *clip)
+		{
+			key_times.push_back(time);
+			appendKey(keys, pose);
+		}
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, key_times_ssbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, key_times.size() * sizeof(float), key_times.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, keys_ssbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, keys.size() * sizeof(float), keys.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void PoseCompute::uploadRest(const std::vector<Animation> &rest)
+{
+	std::vector<float> keys;
+
+	appendKey(keys, rest);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, keys_ssbo);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, rest_keys[0] * 4 * sizeof(float), keys.size() * sizeof(float), keys.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void PoseCompute::evaluate(const PoseFrame &frame)
+{
+	if (frame.clips != resident)
+		uploadClips(frame.clips, frame.rest);
+	else
+		uploadRest(frame.rest);
+
+	instances.resize(frame.instance_count);
+
+	for (size_t i = 0; i < frame.instance_count; i++)
+	{
+		int clip = frame.instance_clips[i];
+		size_t rig = frame.instance_rigs[i];
+		InstanceData &instance = instances[i];
+
+		for (size_t c = 0; c < 3; c++)
+			instance.offset_time[c] = frame.offsets[3 * i + c];
+		instance.offset_time[3] = frame.instance_times[i];
+
+		instance.clip[0] = clip < 0 ? 0 : first_times[clip];
+		instance.clip[1] = clip < 0 ? 1 : resident[clip]->size();
+		instance.clip[2] = clip < 0 ? rest_keys[rig] : first_keys[clip];
+
+		instance.rig[0] = first_parents[rig];
+		instance.rig[1] = rigs[rig].size();
+		instance.rig[2] = frame.first_bones[i];
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, instances_ssbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(InstanceData), instances.data(), GL_STREAM_DRAW);
+
+	if (frame.total_bones > capacity)
+	{
+		capacity = frame.total_bones;
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, transforms_ssbo);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * 16 * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, colors_ssbo);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * 3 * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, transforms_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, colors_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, instances_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, key_times_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, keys_ssbo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, parents_ssbo);
+
+	glUseProgram(program);
+	glUniform1ui(glGetUniformLocation(program, "uInstanceCount"), frame.instance_count);
+	glDispatchCompute((frame.instance_count + POSE_COMPUTE_GROUP_SIZE - 1) / POSE_COMPUTE_GROUP_SIZE, 1, 1);
+
+	// the vertex shader reads the results as storage buffers too
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
@@ -0,0 +1,46 @@
+#ifndef POSECOMPUTE_HPP
+#define POSECOMPUTE_HPP
+
+#include <GL/glew.h>
+#include "Simulation.hpp"
+
+// Evaluates the poses of a PoseFrame with a compute shader (GL 4.3+).
+// Clip keyframes are uploaded into storage buffers once, then only the sample time and
+// offset of each instance go up every frame. The dispatch writes world matrices and colors
+// straight into the buffers the instanced shaders draw from (bindings 0 and 1).
+class PoseCompute
+{
+private:
+	struct InstanceData
+	{
+		float offset_time[4];
+		GLuint clip[4]; // first key time, key count, first key
+		GLuint rig[4];	// first parent, bone count, first output bone
+	};
+
+	GLuint program;
+	GLuint transforms_ssbo, colors_ssbo, instances_ssbo, key_times_ssbo, keys_ssbo, parents_ssbo;
+	size_t capacity;
+
+	std::vector<Skeleton> rigs;
+	std::vector<GLuint> first_parents;
+	std::vector<GLuint> rest_keys; // one rest pose per rig, all at time 0
+
+	std::vector<std::shared_ptr<const Animations>> resident;
+	std::vector<GLuint> first_times;
+	std::vector<GLuint> first_keys;
+	std::vector<InstanceData> instances;
+
+	void uploadClips(const std::vector<std::shared_ptr<const Animations>> &clips, const std::vector<Animation> &rest);
+	void uploadRest(const std::vector<Animation> &rest);
+
+public:
+	static bool isSupported(const std::vector<Skeleton> &rigs);
+
+	PoseCompute(GLuint program, const std::vector<Skeleton> &rigs);
+	~PoseCompute();
+
+	void evaluate(const PoseFrame &frame);
+};
+
+#endif
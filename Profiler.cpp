@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include "Profiler.hpp"
+
+Profiler profiler;
+
+const char *getProfileZoneName(ProfileZone zone)
+{
+	const char *names[ProfileZoneCount] = {"frame", "step", "sample", "propagate", "bones", "wait", "render", "imgui", "swap", "load"};
+
+	return zone < ProfileZoneCount ? names[zone] : "unknown";
+}
+
+const char *getProfileCounterName(ProfileCounter counter)
+{
+	const char *names[ProfileCounterCount] = {"bones drawn", "clips loaded", "allocations", "bytes allocated", "peak live bytes"};
+
+	return counter < ProfileCounterCount ? names[counter] : "unknown";
+}
+
+ProfileRing::ProfileRing() : samples(), head(0), tail(0), dropped(0)
+{
+}
+
+Profiler::Profiler()
+	: enabled(false), frame_start(0), frame_count(0), next(0), frame_times(PROFILER_HISTORY, 0.0f),
+	  zone_times(PROFILER_HISTORY * ProfileZoneCount, 0.0f), zone_allocations(PROFILER_HISTORY * ProfileZoneCount, 0.0f),
+	  frame_allocations(PROFILER_HISTORY, 0.0f), frame_bytes(PROFILER_HISTORY, 0.0f), frame_peaks(PROFILER_HISTORY, 0.0f), totals(),
+	  allocation_totals(), frame_allocations_start(), dropped(0), counters(), trace_start(0)
+{
+}
+
+Profiler::~Profiler()
+{
+	stopTrace();
+}
+
+uint64_t Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool Profiler::isEnabled() const
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+// Starts over from an empty history, so that averages never mix in frames from before
+void Profiler::setEnabled(bool enabled)
+{
+	if (enabled && !isEnabled())
+		reset();
+	this->enabled.store(enabled, std::memory_order_relaxed);
+	setAllocationTracking(enabled);
+}
+
+// Names the calling thread in traces
+void Profiler::setThreadName(const std::string &name)
+{
+	ProfileRing &ring = getRing();
+	std::lock_guard<std::mutex> lock(mutex);
+
+	ring.thread_name = name;
+}
+
+// Rings are never freed, a thread that exits leaves its own behind, empty
+ProfileRing &Profiler::getRing()
+{
+	thread_local ProfileRing *ring = nullptr;
+
+	if (ring == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		rings.push_back(std::make_unique<ProfileRing>());
+		ring = rings.back().get();
+	}
+
+	return *ring;
+}
+
+void Profiler::record(ProfileZone zone, uint64_t start, uint64_t end, const AllocationStats &allocations)
+{
+	ProfileRing &ring = getRing();
+	uint64_t head = ring.head.load(std::memory_order_relaxed);
+
+	if (head - ring.tail.load(std::memory_order_acquire) >= PROFILER_RING_SIZE)
+	{
+		ring.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ring.samples[head % PROFILER_RING_SIZE] = ProfileSample{start, end, zone, (uint32_t)allocations.count, allocations.bytes};
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::drain(ProfileRing &ring, size_t thread)
+{
+	uint64_t head = ring.head.load(std::memory_order_acquire);
+	uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+
+	dropped += ring.dropped.exchange(0, std::memory_order_relaxed);
+
+	for (; tail < head; tail++)
+	{
+		const ProfileSample &sample = ring.samples[tail % PROFILER_RING_SIZE];
+
+		totals[sample.zone] += (sample.end - sample.start) / 1e6f;
+		allocation_totals[sample.zone] += sample.allocations;
+
+		if (!trace.is_open())
+			continue;
+
+		writeEvent() << "{\"name\":\"" << getProfileZoneName(sample.zone) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+					 << ",\"ts\":" << getTraceTime(sample.start) << ",\"dur\":" << (sample.end - sample.start) / 1e3;
+		if (sample.allocations > 0)
+			trace << ",\"args\":{\"allocations\":" << sample.allocations << ",\"bytes\":" << sample.bytes << "}";
+		trace << "}";
+	}
+
+	// hands the slots read back to the thread
+	ring.tail.store(tail, std::memory_order_release);
+}
+
+// Called by the render thread once per frame. Samples of other threads count toward the
+// frame they are drained in, so the simulation's work lands in the frame that waited on it.
+void Profiler::endFrame()
+{
+	if (!isEnabled())
+		return;
+
+	uint64_t end = now();
+	AllocationStats allocations = getAllocations();
+
+	counters[AllocationsCounter] = allocations.count - frame_allocations_start.count;
+	counters[AllocatedBytesCounter] = allocations.bytes - frame_allocations_start.bytes;
+	counters[PeakBytesCounter] = takePeakBytes();
+	frame_allocations_start = allocations;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (size_t i = 0; i < rings.size(); i++)
+			drain(*rings[i], i + 1);
+	}
+
+	for (size_t counter = 0; counter < ProfileCounterCount && trace.is_open(); counter++)
+		writeEvent() << "{\"name\":\"" << getProfileCounterName((ProfileCounter)counter) << "\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+					 << getTraceTime(end) << ",\"args\":{\"value\":" << counters[counter] << "}}";
+
+	if (frame_start != 0)
+	{
+		frame_times[next] = (end - frame_start) / 1e6f;
+		frame_allocations[next] = counters[AllocationsCounter];
+		frame_bytes[next] = counters[AllocatedBytesCounter];
+		frame_peaks[next] = counters[PeakBytesCounter];
+		std::copy(totals, totals + ProfileZoneCount, &zone_times[next * ProfileZoneCount]);
+		std::copy(allocation_totals, allocation_totals + ProfileZoneCount, &zone_allocations[next * ProfileZoneCount]);
+		next = (next + 1) % PROFILER_HISTORY;
+		frame_count = std::min(frame_count + 1, (size_t)PROFILER_HISTORY);
+	}
+
+	std::fill(totals, totals + ProfileZoneCount, 0.0f);
+	std::fill(allocation_totals, allocation_totals + ProfileZoneCount, 0.0f);
+	frame_start = end;
+}
+
+// Throws away the history and whatever the rings still hold
+void Profiler::reset()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (size_t i = 0; i < rings.size(); i++)
+			drain(*rings[i], i + 1);
+	}
+
+	std::fill(totals, totals + ProfileZoneCount, 0.0f);
+	std::fill(allocation_totals, allocation_totals + ProfileZoneCount, 0.0f);
+	frame_allocations_start = getAllocations();
+	takePeakBytes();
+	frame_start = 0;
+	frame_count = 0;
+	next = 0;
+	dropped = 0;
+}
+
+size_t Profiler::getFrameCount() const
+{
+	return frame_count;
+}
+
+size_t Profiler::getDropped() const
+{
+	return dropped;
+}
+
+float Profiler::getAverage(ProfileZone zone) const
+{
+	float sum = 0.0f;
+
+	for (size_t i = 0; i < frame_count; i++)
+		sum += zone_times[i * ProfileZoneCount + zone];
+
+	return frame_count > 0 ? sum / frame_count : 0.0f;
+}
+
+float Profiler::getAverageFrameTime() const
+{
+	float sum = 0.0f;
+
+	for (size_t i = 0; i < frame_count; i++)
+		sum += frame_times[i];
+
+	return frame_count > 0 ? sum / frame_count : 0.0f;
+}
+
+float Profiler::getAverageAllocations(ProfileZone zone) const
+{
+	float sum = 0.0f;
+
+	for (size_t i = 0; i < frame_count; i++)
+		sum += zone_allocations[i * ProfileZoneCount + zone];
+
+	return frame_count > 0 ? sum / frame_count : 0.0f;
+}
+
+float Profiler::getAverageFrameAllocations() const
+{
+	float sum = 0.0f;
+
+	for (size_t i = 0; i < frame_count; i++)
+		sum += frame_allocations[i];
+
+	return frame_count > 0 ? sum / frame_count : 0.0f;
+}
+
+float Profiler::getAverageFrameBytes() const
+{
+	float sum = 0.0f;
+
+	for (size_t i = 0; i < frame_count; i++)
+		sum += frame_bytes[i];
+
+	return frame_count > 0 ? sum / frame_count : 0.0f;
+}
+
+float Profiler::getPeakBytes() const
+{
+	float peak = 0.0f;
+
+	for (size_t i = 0; i < frame_count; i++)
+		peak = std::fmax(peak, frame_peaks[i]);
+
+	return peak;
+}
+
+std::vector<float> Profiler::getFrameTimes() const
+{
+	std::vector<float> times;
+
+	for (size_t i = 0; i < frame_count; i++)
+		times.push_back(frame_times[(next + PROFILER_HISTORY - frame_count + i) % PROFILER_HISTORY]);
+
+	return times;
+}
+
+// Enables the profiler and writes everything it records from now on into path, as a
+// JSON array of trace events that is closed by stopTrace()
+bool Profiler::startTrace(const std::string &path)
+{
+	stopTrace();
+	setEnabled(true);
+
+	trace.open(path);
+	if (!trace.is_open())
+	{
+		std::cerr << "Cannot write trace " << path << std::endl;
+		return false;
+	}
+
+	trace_path = path;
+	trace_start = now();
+	trace << std::fixed << std::setprecision(3);
+	trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	trace << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"humanGL\"}}";
+
+	return true;
+}
+
+// Drains what is left and names the threads seen
+void Profiler::stopTrace()
+{
+	if (!trace.is_open())
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (size_t i = 0; i < rings.size(); i++)
+	{
+		drain(*rings[i], i + 1);
+		if (!rings[i]->thread_name.empty())
+			writeEvent() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i + 1 << ",\"args\":{\"name\":\""
+						 << rings[i]->thread_name << "\"}}";
+	}
+
+	trace << "\n]}\n";
+	trace.close();
+	std::cout << "Trace written to " << trace_path << std::endl;
+}
+
+bool Profiler::isTracing() const
+{
+	return trace.is_open();
+}
+
+// Every event after the header one is preceded by a comma. Events are streamed
+// straight into the file, so that tracing allocates nothing per frame.
+std::ofstream &Profiler::writeEvent()
+{
+	trace << ",\n";
+
+	return trace;
+}
+
+// Microseconds since the trace started
+double Profiler::getTraceTime(uint64_t time) const
+{
+	return time > trace_start ? (time - trace_start) / 1e3 : 0.0;
+}
+
+int64_t Profiler::getCounter(ProfileCounter counter) const
+{
+	return counters[counter];
+}
+
+// Sampled into traces once per frame
+void Profiler::setCounter(ProfileCounter counter, int64_t value)
+{
+	counters[counter] = value;
+}
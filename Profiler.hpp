@@ -0,0 +1,171 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Allocations.hpp"
+#include "settings.hpp"
+
+typedef enum ProfileZone {
+	FrameZone = 0, // one whole iteration of the render loop
+	StepZone,	   // fixed steps of every instance's playback
+	SampleZone,	   // keyframes sampled and blended into local poses
+	PropagateZone, // local poses turned into world transforms
+	BoneZone,	   // editable bone hierarchy read or updated
+	WaitZone,	   // render thread waiting on the simulation
+	RenderZone,
+	ImGuiZone,
+	SwapZone,
+	LoadZone,	   // animation files parsed
+	ProfileZoneCount
+} ProfileZone;
+
+const char *getProfileZoneName(ProfileZone zone);
+
+typedef enum ProfileCounter {
+	BonesCounter = 0,
+	ClipsCounter,
+	AllocationsCounter, // set by the profiler itself, per frame
+	AllocatedBytesCounter,
+	PeakBytesCounter,
+	ProfileCounterCount
+} ProfileCounter;
+
+const char *getProfileCounterName(ProfileCounter counter);
+
+struct ProfileSample
+{
+	uint64_t start; // nanoseconds
+	uint64_t end;
+	ProfileZone zone;
+	uint32_t allocations; // made by the thread in the meantime
+	uint64_t bytes;
+};
+
+// Samples of one thread, written by it alone and drained by the render thread.
+// The slots in [tail, head) belong to the reader until it moves tail past them, so a
+// writer that would lap it drops its new sample instead of overwriting one being read.
+struct ProfileRing
+{
+	ProfileSample samples[PROFILER_RING_SIZE];
+	std::atomic<uint64_t> head; // written by the thread
+	std::atomic<uint64_t> tail; // written by the reader
+	std::atomic<uint64_t> dropped; // by the thread, since the last drain
+	std::string thread_name;
+
+	ProfileRing();
+};
+
+// Time spent in each zone per frame, summed over every thread and averaged over the
+// last PROFILER_HISTORY frames. Each thread records into its own ring buffer, so timing
+// a scope never takes a lock, and while disabled a scope costs a single atomic load.
+// Allocations are tracked while it is enabled, per frame and per zone.
+// While tracing, every sample drained and the counters of every frame are also written to
+// a Chrome trace event file (chrome://tracing, ui.perfetto.dev).
+class Profiler
+{
+private:
+	std::atomic<bool> enabled;
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ProfileRing>> rings;
+
+	uint64_t frame_start;
+	size_t frame_count; // recorded in the history, up to PROFILER_HISTORY
+	size_t next;
+	std::vector<float> frame_times; // milliseconds, PROFILER_HISTORY of them
+	std::vector<float> zone_times;	// milliseconds, PROFILER_HISTORY per zone
+	std::vector<float> zone_allocations; // PROFILER_HISTORY per zone
+	std::vector<float> frame_allocations;
+	std::vector<float> frame_bytes;
+	std::vector<float> frame_peaks;
+	float totals[ProfileZoneCount];
+	float allocation_totals[ProfileZoneCount];
+	AllocationStats frame_allocations_start;
+	size_t dropped;
+	int64_t counters[ProfileCounterCount];
+
+	std::ofstream trace;
+	std::string trace_path;
+	uint64_t trace_start;
+
+	ProfileRing &getRing();
+	void drain(ProfileRing &ring, size_t thread);
+	std::ofstream &writeEvent();
+	double getTraceTime(uint64_t time) const;
+
+public:
+	Profiler();
+	~Profiler();
+
+	static uint64_t now();
+
+	bool isEnabled() const;
+	void setEnabled(bool enabled);
+
+	void setThreadName(const std::string &name);
+	void record(ProfileZone zone, uint64_t start, uint64_t end, const AllocationStats &allocations);
+	void endFrame();
+	void reset();
+
+	bool startTrace(const std::string &path);
+	void stopTrace();
+	bool isTracing() const;
+
+	int64_t getCounter(ProfileCounter counter) const;
+	void setCounter(ProfileCounter counter, int64_t value);
+
+	size_t getFrameCount() const;
+	size_t getDropped() const;
+	float getAverage(ProfileZone zone) const;
+	float getAverageFrameTime() const;
+	float getAverageAllocations(ProfileZone zone) const;
+	float getAverageFrameAllocations() const;
+	float getAverageFrameBytes() const;
+	float getPeakBytes() const; // highest over the history
+	std::vector<float> getFrameTimes() const; // oldest first
+};
+
+extern Profiler profiler;
+
+// Records the time until the end of the enclosing scope into zone, with the allocations
+// made by the thread meanwhile
+class ProfileScope
+{
+private:
+	ProfileZone zone;
+	uint64_t start;
+	AllocationStats allocations;
+
+public:
+	ProfileScope(ProfileZone zone)
+		: zone(zone), start(profiler.isEnabled() ? Profiler::now() : 0), allocations(start != 0 ? getThreadAllocations() : AllocationStats())
+	{
+	}
+
+	~ProfileScope()
+	{
+		if (start == 0)
+			return;
+
+		AllocationStats now = getThreadAllocations();
+
+		profiler.record(zone, start, Profiler::now(), AllocationStats{now.count - allocations.count, now.bytes - allocations.bytes});
+	}
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if PROFILER
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(zone)
+#else
+#define PROFILE_SCOPE(zone)
+#endif
+
+#endif
@@ -0,0 +1,227 @@
+#include <cstring>
+#include "Renderer.hpp"
+
+static size_t alignUp(size_t size, size_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+Renderer::Renderer()
+	: instance_buffer(0), mapped(nullptr), capacity(0), colors_offset(0), bones_offset(0), commands_offset(0), region_size(0),
+	  fences(), region(0), command_count(0)
+{
+	float vertices[] = {
+		-0.5f, -0.5f, -0.5f,
+		0.5f, -0.5f, -0.5f,
+		0.5f, 0.5f, -0.5f,
+		-0.5f, 0.5f, -0.5f,
+
+		-0.5f, -0.5f, 0.5f,
+		0.5f, -0.5f, 0.5f,
+		0.5f, 0.5f, 0.5f,
+		-0.5f, 0.5f, 0.5f};
+
+	// this way the cube sits on the origin and the rotation is the cube's orientation wihtout having to translate it
+	for (int i = 1; i < 24; i += 3)
+		vertices[i] += 0.5;
+
+	uint indices[] = {
+		0, 1, 2, 2, 3, 0,
+		4, 5, 6, 6, 7, 4,
+		0, 3, 7, 7, 4, 0,
+		1, 2, 6, 6, 5, 1,
+		3, 2, 6, 6, 7, 3,
+		0, 1, 5, 5, 4, 0};
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+	glEnableVertexAttribArray(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	meshes[Cube] = {36, 0, 0};
+
+	bool storage = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+	bool ssbo = GLEW_VERSION_4_3 || GLEW_ARB_shader_storage_buffer_object;
+	bool indirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+
+	batched = storage && ssbo && indirect;
+
+	// index of the bone drawn by each instance, offset by the base instance of its command
+	if (batched)
+	{
+		glEnableVertexAttribArray(1);
+		glVertexAttribDivisor(1, 1);
+	}
+
+	glBindVertexArray(0);
+}
+
+Renderer::~Renderer()
+{
+	release();
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+}
+
+bool Renderer::isBatched() const
+{
+	return batched;
+}
+
+// Waits for the GPU to be done with every region, then unmaps and deletes the buffer
+void Renderer::release()
+{
+	for (GLsync &fence : fences)
+	{
+		if (fence == nullptr)
+			continue;
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	if (instance_buffer == 0)
+		return;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, instance_buffer);
+	glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glDeleteBuffers(1, &instance_buffer);
+
+	instance_buffer = 0;
+	mapped = nullptr;
+}
+
+// Immutable storage cannot be resized, so growing means a new buffer
+void Renderer::reserve(size_t bones)
+{
+	if (bones <= capacity)
+		return;
+
+	GLint alignment;
+
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	release();
+
+	capacity = std::max(bones, (size_t)INSTANCE_BUFFER_BONES);
+	colors_offset = alignUp(capacity * 16 * sizeof(float), alignment);
+	bones_offset = alignUp(colors_offset + capacity * 3 * sizeof(float), alignment);
+	commands_offset = alignUp(bones_offset + capacity * sizeof(GLuint), alignment);
+	region_size = alignUp(commands_offset + MeshTypeCount * sizeof(DrawCommand), alignment);
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &instance_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, instance_buffer);
+	glBufferStorage(GL_SHADER_STORAGE_BUFFER, region_size * INSTANCE_RING_SIZE, nullptr, flags);
+	mapped = (char *)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, region_size * INSTANCE_RING_SIZE, flags);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	if (mapped == nullptr)
+	{
+		std::cerr << "Failed to map instance buffer." << std::endl;
+		exit(-1);
+	}
+}
+
+// Fills the next region once the GPU has finished reading it: pose data (unless PoseCompute
+// already wrote it on the GPU), bone indices sorted by mesh, and one draw command per mesh
+void Renderer::stream(const PoseFrame &frame)
+{
+	size_t bones = frame.total_bones;
+
+	reserve(bones);
+
+	region = (region + 1) % INSTANCE_RING_SIZE;
+
+	if (fences[region] != nullptr)
+	{
+		glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fences[region]);
+		fences[region] = nullptr;
+	}
+
+	size_t offset = region * region_size;
+
+	if (!frame.gpu)
+	{
+		memcpy(mapped + offset, frame.transforms.data(), bones * 16 * sizeof(float));
+		memcpy(mapped + offset + colors_offset, frame.colors.data(), bones * 3 * sizeof(float));
+
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, instance_buffer, offset, bones * 16 * sizeof(float));
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, instance_buffer, offset + colors_offset, bones * 3 * sizeof(float));
+	}
+
+	GLuint counts[MeshTypeCount] = {0};
+	GLuint firsts[MeshTypeCount];
+	GLuint *indices = (GLuint *)(mapped + offset + bones_offset);
+	DrawCommand *commands = (DrawCommand *)(mapped + offset + commands_offset);
+
+	for (MeshType mesh : frame.meshes)
+		counts[mesh]++;
+
+	command_count = 0;
+	for (size_t mesh = 0, first = 0; mesh < MeshTypeCount; first += counts[mesh], mesh++)
+	{
+		firsts[mesh] = first;
+		if (counts[mesh] > 0)
+			commands[command_count++] = {meshes[mesh].index_count, counts[mesh], meshes[mesh].first_index, meshes[mesh].base_vertex, (GLuint)first};
+	}
+
+	for (size_t bone = 0; bone < bones; bone++)
+		indices[firsts[frame.meshes[bone]]++] = bone;
+
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+	glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void *)(offset + bones_offset));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, instance_buffer);
+}
+
+void Renderer::render(GLuint shaderProgram, const PoseFrame &frame)
+{
+	// nothing to stream, and an empty range cannot be bound
+	if (batched && frame.total_bones == 0)
+		return;
+
+	glBindVertexArray(VAO);
+
+	if (batched)
+	{
+		stream(frame);
+
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void *)(region * region_size + commands_offset), command_count, 0);
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindVertexArray(0);
+		return;
+	}
+
+	GLint modelLoc = glGetUniformLocation(shaderProgram, "uModel");
+	GLint colorLoc = glGetUniformLocation(shaderProgram, "Color");
+
+	for (size_t i = 0; i < frame.total_bones; i++)
+	{
+		const Mesh &mesh = meshes[frame.meshes[i]];
+
+		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &frame.transforms[16 * i]);
+		glUniform3fv(colorLoc, 1, &frame.colors[3 * i]);
+		glDrawElementsBaseVertex(GL_TRIANGLES, mesh.index_count, GL_UNSIGNED_INT, (void *)(mesh.first_index * sizeof(GLuint)), mesh.base_vertex);
+	}
+
+	glBindVertexArray(0);
+}
@@ -0,0 +1,60 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <GL/glew.h>
+#include "Simulation.hpp"
+#include "settings.hpp"
+
+// Draws every bone of every instance of a PoseFrame with the mesh of its bone type.
+// With GL 4.4 the bone matrices and colors are streamed through a persistently mapped
+// buffer split into INSTANCE_RING_SIZE regions, each guarded by a fence. Bones are grouped
+// by mesh into one indirect command per mesh, whatever rig they belong to, and the whole
+// frame goes out in a single glMultiDrawElementsIndirect call. Older contexts fall back
+// to one set of uniforms and one draw call per bone.
+class Renderer
+{
+private:
+	struct Mesh
+	{
+		GLuint index_count;
+		GLuint first_index;
+		GLint base_vertex;
+	};
+
+	struct DrawCommand
+	{
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+
+	GLuint VAO, VBO, EBO;
+	Mesh meshes[MeshTypeCount];
+
+	bool batched;
+	GLuint instance_buffer;
+	char *mapped;
+	size_t capacity; // bones per region
+	// bytes from the start of a region
+	size_t colors_offset, bones_offset, commands_offset;
+	size_t region_size;
+	GLsync fences[INSTANCE_RING_SIZE];
+	size_t region;
+	size_t command_count;
+
+	void reserve(size_t bones);
+	void release();
+	void stream(const PoseFrame &frame);
+
+public:
+	Renderer();
+	~Renderer();
+
+	bool isBatched() const;
+
+	void render(GLuint shaderProgram, const PoseFrame &frame);
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include <iostream>
+#include <GLFW/glfw3.h>
+#include "Clock.hpp"
+#include "InverseKinematics.hpp"
+#include "Replay.hpp"
+
+#define REPLAY_VERSION 2
+
+#define CARRIES_VALUE 1
+#define CARRIES_VALUES 2
+#define CARRIES_NAME 4
+
+static const uint8_t layouts[ReplayEventTypeCount] = {
+	CARRIES_VALUE,	// KeyPressEvent
+	CARRIES_VALUE,	// KeyReleaseEvent
+	CARRIES_VALUES, // CameraEvent
+	CARRIES_VALUES, // RestPoseEvent
+	CARRIES_VALUE | CARRIES_NAME, // PlayEvent
+	0,				// StopEvent
+	CARRIES_VALUES, // SeekEvent
+	CARRIES_VALUE,	// PauseEvent
+	0,				// StepEvent
+	CARRIES_VALUES, // TimeScaleEvent
+	CARRIES_VALUE,	// PlaybackModeEvent
+	CARRIES_VALUE,	// RootMotionEvent
+	CARRIES_VALUE | CARRIES_VALUES | CARRIES_NAME, // ClipEvent
+	CARRIES_NAME,	// DeleteClipEvent
+	CARRIES_VALUES, // CrossfadeEvent
+	CARRIES_VALUE | CARRIES_VALUES | CARRIES_NAME, // AddLayerEvent
+	CARRIES_VALUE | CARRIES_VALUES, // LayerWeightEvent
+	0,				// ClearLayersEvent
+	CARRIES_VALUE | CARRIES_NAME, // StateMachineEvent
+	CARRIES_VALUE | CARRIES_VALUES, // ParameterEvent
+	CARRIES_VALUE,	// PlantFeetEvent
+	CARRIES_VALUE,	// FootSolverEvent
+	CARRIES_VALUE,	// CullingEvent
+	CARRIES_VALUE,	// LodEvent
+	CARRIES_VALUE | CARRIES_VALUES, // PoseCacheEvent
+	0,				// BakePosesEvent
+	0,				// ClearPosesEvent
+	CARRIES_VALUE | CARRIES_VALUES, // CompressionEvent
+	0,				// CompressClipsEvent
+	0				// ClearCompressedEvent
+};
+
+template <typename T>
+static void write(std::ofstream &file, T value)
+{
+	file.write((const char *)&value, sizeof(value));
+}
+
+template <typename T>
+static bool read(std::ifstream &file, T &value)
+{
+	return (bool)file.read((char *)&value, sizeof(value));
+}
+
+ReplayEvent::ReplayEvent(ReplayEventType type, int32_t value, const std::vector<float> &values, const std::string &name)
+	: type(type), value(value), values(values), name(name), frame(0)
+{
+}
+
+ReplayRecorder::ReplayRecorder(const std::string &path, double frame_time) : file(path, std::ios::binary), path(path), frame(0)
+{
+	if (!file.is_open())
+	{
+		std::cerr << "Cannot record replay " << path << std::endl;
+		return;
+	}
+
+	file.write("HGLR", 4);
+	write<uint32_t>(file, REPLAY_VERSION);
+	write<double>(file, frame_time);
+	write<uint32_t>(file, 0);
+}
+
+// The frame count is only known once recording stops
+ReplayRecorder::~ReplayRecorder()
+{
+	if (!file.is_open())
+		return;
+
+	file.seekp(4 + sizeof(uint32_t) + sizeof(double));
+	write<uint32_t>(file, frame);
+	std::cout << "Recorded " << frame << " frame(s) into " << path << std::endl;
+}
+
+bool ReplayRecorder::isOpen() const
+{
+	return file.is_open();
+}
+
+void ReplayRecorder::record(ReplayEvent event)
+{
+	if (!file.is_open() || event.type >= ReplayEventTypeCount || (event.type == CameraEvent && event.values == camera))
+		return;
+
+	if (event.type == CameraEvent)
+		camera = event.values;
+
+	uint8_t layout = layouts[event.type];
+
+	write<uint32_t>(file, frame);
+	write<uint8_t>(file, event.type);
+	if (layout & CARRIES_VALUE)
+		write<int32_t>(file, event.value);
+	if (layout & CARRIES_VALUES)
+	{
+		write<uint32_t>(file, event.values.size());
+		file.write((const char *)event.values.data(), event.values.size() * sizeof(float));
+	}
+	if (layout & CARRIES_NAME)
+	{
+		write<uint32_t>(file, event.name.size());
+		file.write(event.name.data(), event.name.size());
+	}
+}
+
+void ReplayRecorder::endFrame()
+{
+	frame++;
+}
+
+static bool readEvent(std::ifstream &file, ReplayEvent &event)
+{
+	uint8_t type;
+	uint32_t size;
+
+	event = ReplayEvent();
+	if (!read(file, event.frame) || !read(file, type) || type >= ReplayEventTypeCount)
+		return false;
+
+	uint8_t layout = layouts[type];
+
+	event.type = (ReplayEventType)type;
+	if ((layout & CARRIES_VALUE) && !read(file, event.value))
+		return false;
+	if (layout & CARRIES_VALUES)
+	{
+		if (!read(file, size))
+			return false;
+		event.values.resize(size);
+		if (!file.read((char *)event.values.data(), size * sizeof(float)))
+			return false;
+	}
+	if (layout & CARRIES_NAME)
+	{
+		if (!read(file, size))
+			return false;
+		event.name.resize(size);
+		if (!file.read(event.name.data(), size))
+			return false;
+	}
+
+	// replays index tables and switch on values as they are
+	if (event.type == KeyPressEvent || event.type == KeyReleaseEvent)
+		return event.value >= 0 && event.value <= GLFW_KEY_LAST;
+	if (event.type == PlayEvent || event.type == StateMachineEvent)
+		return event.value >= 0 && event.value < InterpolationCount;
+	if (event.type == PlaybackModeEvent)
+		return event.value >= 0 && event.value < PlaybackModeCount;
+	if (event.type == FootSolverEvent)
+		return event.value >= 0 && event.value < IkSolverCount;
+	if (event.type == AddLayerEvent)
+		return event.value >= 0 && event.value < InterpolationCount && event.values.size() >= 2;
+	if ((event.type == LayerWeightEvent || event.type == ParameterEvent) && event.value < 0)
+		return false;
+
+	// and read the values by index
+	if (event.type == CameraEvent)
+		return event.values.size() == 9;
+	if (event.type == SeekEvent || event.type == TimeScaleEvent || event.type == CrossfadeEvent || event.type == LayerWeightEvent ||
+		event.type == ParameterEvent || event.type == PoseCacheEvent || event.type == CompressionEvent)
+		return event.values.size() == 1;
+
+	if (event.type == RestPoseEvent)
+		return event.values.size() % 12 == 0;
+	if (event.type == ClipEvent)
+		return event.value > 0 ? event.values.size() % (1 + 12 * (size_t)event.value) == 0 : event.value == 0 && event.values.empty();
+
+	return true;
+}
+
+std::shared_ptr<const Replay> loadReplay(const std::string &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	char magic[4];
+	uint32_t version;
+
+	if (!file.is_open())
+	{
+		std::cerr << "Replay " << path << " not found" << std::endl;
+		return nullptr;
+	}
+
+	std::shared_ptr<Replay> replay = std::make_shared<Replay>();
+
+	if (!file.read(magic, 4) || std::string(magic, 4) != "HGLR" || !read(file, version) || version != REPLAY_VERSION ||
+		!read(file, replay->frame_time) || !read(file, replay->frame_count) || replay->frame_time <= 0.0)
+	{
+		std::cerr << "Replay " << path << " is not a valid recording" << std::endl;
+		return nullptr;
+	}
+
+	ReplayEvent event;
+
+	while (file.peek() != EOF)
+	{
+		if (!readEvent(file, event) || event.frame >= replay->frame_count ||
+			(!replay->events.empty() && event.frame < replay->events.back().frame))
+		{
+			std::cerr << "Replay " << path << " is truncated or corrupted after " << replay->events.size() << " event(s)" << std::endl;
+			return nullptr;
+		}
+		replay->events.push_back(event);
+	}
+
+	std::cout << "Replay " << path << " loaded: " << replay->frame_count << " frame(s), " << replay->events.size() << " event(s)" << std::endl;
+
+	return replay;
+}
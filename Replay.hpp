@@ -0,0 +1,89 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef enum ReplayEventType {
+	KeyPressEvent = 0, // value: key
+	KeyReleaseEvent,   // value: key
+	CameraEvent,	   // values: eye, center and up
+	RestPoseEvent,	   // values: 12 per bone, see flattenPose
+	PlayEvent,		   // name: clip, value: interpolation
+	StopEvent,
+	SeekEvent,		   // values: time
+	PauseEvent,		   // value: paused
+	StepEvent,
+	TimeScaleEvent,	   // values: scale
+	PlaybackModeEvent, // value: mode
+	RootMotionEvent,   // value: enabled
+	ClipEvent,		   // name: clip, value: bones, values: time then 12 per bone for each keyframe, see flattenClip
+	DeleteClipEvent,   // name: clip
+	CrossfadeEvent,	   // values: seconds
+	AddLayerEvent,	   // name: clip, value: interpolation, values: weight, additive, then the masked bone indices
+	LayerWeightEvent,  // value: layer, values: weight
+	ClearLayersEvent,
+	StateMachineEvent, // name: text of the file, none to stop, value: interpolation
+	ParameterEvent,	   // value: parameter, values: value
+	PlantFeetEvent,	   // value: enabled
+	FootSolverEvent,   // value: solver
+	CullingEvent,	   // value: enabled
+	LodEvent,		   // value: enabled
+	PoseCacheEvent,	   // value: enabled, values: rate
+	BakePosesEvent,
+	ClearPosesEvent,
+	CompressionEvent,  // value: enabled, values: tolerance
+	CompressClipsEvent,
+	ClearCompressedEvent,
+	ReplayEventTypeCount
+} ReplayEventType;
+
+struct ReplayEvent
+{
+	ReplayEventType type;
+	int32_t value;
+	std::vector<float> values;
+	std::string name;
+	uint32_t frame; // filled in by the recorder
+
+	ReplayEvent(ReplayEventType type = StopEvent, int32_t value = 0, const std::vector<float> &values = {}, const std::string &name = "");
+};
+
+// Writes the inputs of a session that change what is drawn, frame by frame, as it happens.
+// Edited clips and state machines are written whole, so that replays never depend on files
+// saved meanwhile. Startup options are not recorded: replays are given the same ones.
+//     "HGLR", u32 version, f64 frame time, u32 frame count,
+//     events in frame order: u32 frame, u8 type, then what the type carries out of
+//     i32 value, u32 count + count x f32 values, u32 length + name.
+// The camera is sent every frame but only written when it moves.
+class ReplayRecorder
+{
+private:
+	std::ofstream file;
+	std::string path;
+	uint32_t frame;
+	std::vector<float> camera;
+
+public:
+	ReplayRecorder(const std::string &path, double frame_time);
+	~ReplayRecorder();
+
+	bool isOpen() const;
+	void record(ReplayEvent event);
+	void endFrame();
+};
+
+// A whole recording, read up front so that replaying never touches the disk
+struct Replay
+{
+	double frame_time;
+	uint32_t frame_count;
+	std::vector<ReplayEvent> events;
+};
+
+std::shared_ptr<const Replay> loadReplay(const std::string &path);
+
+#endif
@@ -0,0 +1,45 @@
+#include <algorithm>
+#include "Retarget.hpp"
+
+// Shares at least one bone; a rig matching none would only ever show its fallback pose
+bool RetargetMap::isCompatible() const
+{
+	return std::any_of(sources.begin(), sources.end(), [](int source)
+					   { return source >= 0; });
+}
+
+RetargetMap getRetargetMap(const Skeleton &from, const Skeleton &to)
+{
+	RetargetMap map;
+
+	map.source_size = from.size();
+	for (const std::string &name : to.names)
+	{
+		auto it = std::find(from.names.begin(), from.names.end(), name);
+
+		map.sources.push_back(it == from.names.end() ? -1 : it - from.names.begin());
+	}
+
+	return map;
+}
+
+std::vector<Animation> retargetPose(const std::vector<Animation> &pose, const RetargetMap &map, const std::vector<Animation> &fallback)
+{
+	std::vector<Animation> retargeted(fallback);
+
+	for (size_t bone = 0; bone < map.sources.size(); bone++)
+		if (map.sources[bone] >= 0)
+			retargeted[bone] = pose[map.sources[bone]];
+
+	return retargeted;
+}
+
+Animations retargetClip(const Animations &clip, const RetargetMap &map, const std::vector<Animation> &fallback)
+{
+	Animations retargeted;
+
+	for (const auto &[time, pose] : clip)
+		retargeted[time] = retargetPose(pose, map, fallback);
+
+	return retargeted;
+}
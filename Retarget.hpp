@@ -0,0 +1,21 @@
+#ifndef RETARGET_HPP
+#define RETARGET_HPP
+
+#include "Skeleton.hpp"
+
+// Where each bone of a rig takes its pose from in a pose of another rig, matched by name
+struct RetargetMap
+{
+	size_t source_size;
+	std::vector<int> sources; // one per target bone, -1 for the bones only the target has
+
+	bool isCompatible() const;
+};
+
+RetargetMap getRetargetMap(const Skeleton &from, const Skeleton &to);
+
+// Bones the source does not have keep their pose in fallback, usually the bind pose of the target
+std::vector<Animation> retargetPose(const std::vector<Animation> &pose, const RetargetMap &map, const std::vector<Animation> &fallback);
+Animations retargetClip(const Animations &clip, const RetargetMap &map, const std::vector<Animation> &fallback);
+
+#endif
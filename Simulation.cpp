@@ -0,0 +1,956 @@
+#include <algorithm>
+#include <cmath>
+#include "Profiler.hpp"
+#include "Simulation.hpp"
+#include "settings.hpp"
+
+SimulationSettings::SimulationSettings()
+	: paused(false), time_scale(1.0), mode(Once), gpu(false), culling(true), lod(true), crossfade(CROSSFADE_DURATION), planting(false), ik_solver(TwoBone), root_motion(false)
+{
+}
+
+PoseHistory::PoseHistory() : clip(nullptr), count(0), frame(0), times()
+{
+}
+
+Simulation::Simulation(const std::vector<Skeleton> &rigs, size_t crowd_size)
+	: rigs(rigs), clock(SIMULATION_STEP), running(false), frame_time(0.0), lockstep(false), submitted(false), rest_pose(rigs[0].bind_pose), eye(3), focal_length(0.0f), gpu_poses(false), crossfade_duration(CROSSFADE_DURATION), plant_feet(false), foot_solver(TwoBone), extract_root_motion(false),
+	  cull_instances(true), distant_lod(true), has_frame(false)
+{
+	size_t instance_count = crowd_size + 1;
+	size_t side = (size_t)ceil(sqrt((double)instance_count));
+	std::vector<float> transforms;
+
+	bounds.resize(instance_count);
+
+	// the floor is wherever the feet are in the bind pose
+	const std::vector<std::vector<std::string>> legs = FOOT_IK_CHAINS;
+
+	for (const Skeleton &rig : rigs)
+	{
+		std::vector<IkChain> chains;
+		std::vector<float> heights;
+
+		for (const std::vector<std::string> &names : legs)
+		{
+			IkChain chain = getIkChain(rig, names, TwoBone);
+			float end[3];
+
+			if (chain.bones.empty())
+				continue;
+
+			getChainEnd(rig, rig.bind_pose, vec(3), chain, end);
+			chains.push_back(chain);
+			heights.push_back(end[1]);
+		}
+		feet.push_back(chains);
+		floors.push_back(heights);
+	}
+
+	for (size_t i = 0; i < instance_count; i++)
+	{
+		Instance instance;
+
+		instance.offset = vec({(i % side) * CROWD_SPACING, 0, -(float)(i / side) * CROWD_SPACING});
+		instance.rig = i % rigs.size();
+		// keep the crowd out of lockstep, deterministically
+		instance.playback.scale = 1.0f + CROWD_TIME_SCALE_SPREAD * sinf(i);
+		instances.push_back(instance);
+
+		// until it is first evaluated, and for good when poses are evaluated on the GPU
+		const Skeleton &rig = rigs[instance.rig];
+
+		transforms.resize(16 * rig.size());
+		computeWorldTransforms(rig, rig.bind_pose, instance.offset, transforms.data());
+		bounds.fit(i, transforms.data(), rig.size(), CULL_MARGIN);
+	}
+}
+
+Simulation::~Simulation()
+{
+	stop();
+}
+
+void Simulation::start()
+{
+	if (running)
+		return;
+
+	running = true;
+	thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	consumed.notify_one();
+	produced.notify_all();
+
+	if (thread.joinable())
+		thread.join();
+}
+
+// Advance by exactly frame_time per produced frame instead of following the wall clock
+void Simulation::setFrameTime(double frame_time)
+{
+	this->frame_time = frame_time;
+}
+
+// Set before start(): each frame then waits for submit() instead of being evaluated as soon as
+// the previous one is taken, so commands always land on the frame after the one they were posted in
+void Simulation::setLockstep(bool lockstep)
+{
+	this->lockstep = lockstep;
+}
+
+void Simulation::submit()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		submitted = true;
+	}
+	consumed.notify_one();
+}
+
+void Simulation::post(std::function<void()> command)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	commands.push_back(command);
+}
+
+void Simulation::play(std::shared_ptr<const Animations> clip, std::shared_ptr<const BakedClip> baked,
+					  std::shared_ptr<const CompressedClip> compressed, Interpolation interpolation)
+{
+	if (clip == nullptr || clip->empty())
+		return;
+
+	size_t bone_count = clip->begin()->second.size();
+	std::shared_ptr<const TrackClip> tracks = importTracks(*clip, interpolation);
+	std::vector<std::shared_ptr<const RetargetMap>> retargets;
+
+	for (size_t rig = 0; rig < rigs.size(); rig++)
+		retargets.push_back(getRetarget(bone_count, rig));
+
+	// baked and compressed clips are sampled from linear keyframes, the other modes need the tracks
+	if (interpolation != Linear)
+	{
+		baked.reset();
+		compressed.reset();
+	}
+
+	// other rigs are retargeted by bone name, or keep their rest pose when they share no bone
+	// with the clip; baked poses only fit the first rig
+	post([this, clip, baked, compressed, tracks, retargets, bone_count]
+		 {
+			machine.reset();
+			for (Instance &instance : instances)
+			{
+				std::shared_ptr<const RetargetMap> retarget = retargets[instance.rig];
+
+				fadeOut(instance, crossfade_duration);
+				instance.retarget = retarget;
+				if (rigs[instance.rig].size() != bone_count && retarget == nullptr)
+					instance.playback.stop();
+				else
+					instance.playback.play(clip, instance.rig == 0 ? baked : nullptr, compressed, tracks);
+			} });
+}
+
+void Simulation::stopAnimation()
+{
+	post([this]
+		 {
+			machine.reset();
+			for (Instance &instance : instances)
+			{
+				instance.playback.stop();
+				instance.blender.stopFade();
+				instance.retarget.reset();
+			} });
+}
+
+// Every instance starts over from the first state, nullptr hands playback back to play()
+void Simulation::setStateMachine(std::shared_ptr<const StateMachine> machine)
+{
+	post([this, machine]
+		 {
+			this->machine = machine;
+			if (machine == nullptr)
+				return;
+
+			size_t parameter_count = machine->defaults.size();
+
+			state_retargets.clear();
+			for (const State &state : machine->states)
+				for (size_t rig = 0; rig < rigs.size(); rig++)
+					state_retargets.push_back(getRetarget(state.bone_count, rig));
+			machine_states.assign(instances.size(), 0);
+			state_times.assign(instances.size(), 0.0f);
+			machine_parameters.resize(instances.size() * parameter_count);
+			for (size_t i = 0; i < instances.size(); i++)
+			{
+				std::copy(machine->defaults.begin(), machine->defaults.end(), &machine_parameters[i * parameter_count]);
+				enterState(i, 0, crossfade_duration);
+			} });
+}
+
+// Of every instance
+void Simulation::setParameter(size_t parameter, float value)
+{
+	post([this, parameter, value]
+		 {
+			size_t parameter_count = machine != nullptr ? machine->defaults.size() : 0;
+
+			if (parameter < parameter_count)
+				for (size_t i = 0; i < instances.size(); i++)
+					machine_parameters[i * parameter_count + parameter] = value; });
+}
+
+void Simulation::setParameter(size_t instance, size_t parameter, float value)
+{
+	post([this, instance, parameter, value]
+		 {
+			size_t parameter_count = machine != nullptr ? machine->defaults.size() : 0;
+
+			if (instance < instances.size() && parameter < parameter_count)
+				machine_parameters[instance * parameter_count + parameter] = value; });
+}
+
+// Layers are added to every instance so that indices match, but only play on rigs the clip fits.
+// When mask names bones, the layer only drives them and their descendants, on each rig that has them.
+void Simulation::addLayer(std::shared_ptr<const Animations> clip, float weight, bool additive, Interpolation interpolation,
+						  const std::vector<std::string> &mask)
+{
+	if (clip == nullptr || clip->empty())
+		return;
+
+	size_t bone_count = clip->begin()->second.size();
+	std::shared_ptr<const TrackClip> tracks = importTracks(*clip, interpolation);
+	std::shared_ptr<std::vector<float>> reference = std::make_shared<std::vector<float>>(12 * bone_count);
+	std::vector<std::shared_ptr<const BoneMask>> masks(rigs.size());
+
+	flattenPose(clip->begin()->second, reference->data());
+	for (size_t rig = 0; rig < rigs.size() && !mask.empty(); rig++)
+		masks[rig] = std::make_shared<const BoneMask>(getBoneMask(rigs[rig], mask));
+	post([this, clip, weight, additive, tracks, reference, masks, bone_count]
+		 {
+			for (Instance &instance : instances)
+			{
+				BlendLayer layer;
+
+				layer.weight = weight;
+				layer.additive = additive;
+				layer.reference = reference;
+				layer.mask = masks[instance.rig];
+				layer.playback.scale = instance.playback.scale;
+				layer.playback.setMode(Loop);
+				if (rigs[instance.rig].size() == bone_count)
+					layer.playback.play(clip, nullptr, nullptr, tracks);
+				instance.blender.addLayer(layer);
+			} });
+}
+
+void Simulation::setLayerWeight(size_t layer, float weight)
+{
+	post([this, layer, weight]
+		 {
+			for (Instance &instance : instances)
+				instance.blender.setLayerWeight(layer, weight); });
+}
+
+void Simulation::clearLayers()
+{
+	post([this]
+		 {
+			for (Instance &instance : instances)
+				instance.blender.clearLayers(); });
+}
+
+void Simulation::seek(float time)
+{
+	post([this, time]
+		 {
+			for (Instance &instance : instances)
+				instance.playback.seek(time); });
+}
+
+void Simulation::step()
+{
+	post([this]
+		 {
+			clock.tick();
+			advanceStateMachine(clock.getStep());
+			for (size_t id = 0; id < instances.size(); id++)
+				stepInstance(id, clock.getStep()); });
+}
+
+bool Simulation::isPaused() const
+{
+	return settings.paused;
+}
+
+void Simulation::setPaused(bool paused)
+{
+	settings.paused = paused;
+	post([this, paused]
+		 { clock.setPaused(paused); });
+}
+
+// Holds the clip of one instance while the others play on, until it plays another one
+void Simulation::setPaused(size_t instance, bool paused)
+{
+	post([this, instance, paused]
+		 {
+			if (instance < instances.size())
+				instances[instance].playback.paused = paused; });
+}
+
+double Simulation::getTimeScale() const
+{
+	return settings.time_scale;
+}
+
+void Simulation::setTimeScale(double scale)
+{
+	settings.time_scale = scale;
+	post([this, scale]
+		 { clock.setScale(scale); });
+}
+
+void Simulation::setTimeScale(size_t instance, float scale)
+{
+	post([this, instance, scale]
+		 {
+			if (instance < instances.size())
+				instances[instance].playback.scale = scale; });
+}
+
+PlaybackMode Simulation::getPlaybackMode() const
+{
+	return settings.mode;
+}
+
+// Of every instance
+void Simulation::setPlaybackMode(PlaybackMode mode)
+{
+	settings.mode = mode;
+	post([this, mode]
+		 {
+			for (Instance &instance : instances)
+				instance.playback.setMode(mode); });
+}
+
+void Simulation::setPlaybackMode(size_t instance, PlaybackMode mode)
+{
+	post([this, instance, mode]
+		 {
+			if (instance < instances.size())
+				instances[instance].playback.setMode(mode); });
+}
+
+float Simulation::getCrossfade() const
+{
+	return settings.crossfade;
+}
+
+// 0 switches clips instantly
+void Simulation::setCrossfade(float duration)
+{
+	duration = std::fmax(duration, 0.0f);
+	settings.crossfade = duration;
+	post([this, duration]
+		 { crossfade_duration = duration; });
+}
+
+bool Simulation::isPlantingFeet() const
+{
+	return settings.planting;
+}
+
+void Simulation::setPlantingFeet(bool planting)
+{
+	settings.planting = planting;
+	post([this, planting]
+		 { plant_feet = planting; });
+}
+
+IkSolver Simulation::getFootSolver() const
+{
+	return settings.ik_solver;
+}
+
+void Simulation::setFootSolver(IkSolver solver)
+{
+	settings.ik_solver = solver;
+	post([this, solver]
+		 { foot_solver = solver; });
+}
+
+bool Simulation::isRootMotionEnabled() const
+{
+	return settings.root_motion;
+}
+
+// Instances stay where they are drawn when it is toggled, the root motion of the current
+// cycle moving from the pose to the offset or back
+void Simulation::setRootMotionEnabled(bool enabled)
+{
+	settings.root_motion = enabled;
+	post([this, enabled]
+		 {
+			if (enabled == extract_root_motion)
+				return;
+
+			float sign = enabled ? -1.0f : 1.0f;
+
+			extract_root_motion = true;
+			for (Instance &instance : instances)
+			{
+				vec position = getPosition(instance, 0.0f);
+
+				for (size_t c = 0; c < 3; c++)
+					instance.offset[c] += sign * (position[c] - instance.offset[c]);
+			}
+			extract_root_motion = enabled; });
+}
+
+bool Simulation::isGpuEvaluated() const
+{
+	return settings.gpu;
+}
+
+// Only hand out what the GPU needs to evaluate the poses itself, see PoseCompute, on the
+// frames where it evaluates them the same as the CPU
+void Simulation::setGpuEvaluated(bool gpu)
+{
+	settings.gpu = gpu;
+	post([this, gpu]
+		 { gpu_poses = gpu; });
+}
+
+bool Simulation::isCulling() const
+{
+	return settings.culling;
+}
+
+void Simulation::setCulling(bool culling)
+{
+	settings.culling = culling;
+	post([this, culling]
+		 { cull_instances = culling; });
+}
+
+bool Simulation::isLodEnabled() const
+{
+	return settings.lod;
+}
+
+void Simulation::setLodEnabled(bool lod)
+{
+	settings.lod = lod;
+	post([this, lod]
+		 { distant_lod = lod; });
+}
+
+// The frame being evaluated is shown next, so the view is at most one frame old
+void Simulation::setView(const mat &view, const mat &projection, const vec &eye)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	frustum = Frustum(view * projection);
+	this->eye = eye;
+	focal_length = projection[1][1];
+}
+
+void Simulation::setRestPose(const std::vector<Animation> &pose)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	rest_pose = pose;
+}
+
+const Skeleton &Simulation::getSkeleton() const
+{
+	return rigs[0];
+}
+
+const std::vector<Skeleton> &Simulation::getRigs() const
+{
+	return rigs;
+}
+
+const PoseFrame *Simulation::acquire()
+{
+	if (frames.acquire())
+	{
+		has_frame = true;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+		}
+		consumed.notify_one();
+	}
+
+	return latest();
+}
+
+// Blocks until a frame the renderer has not seen yet is available
+const PoseFrame *Simulation::acquireNext()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		produced.wait(lock, [this]
+					  { return !running || frames.pending(); });
+	}
+
+	return acquire();
+}
+
+const PoseFrame *Simulation::latest() const
+{
+	return has_frame ? &frames.front() : nullptr;
+}
+
+void Simulation::run()
+{
+	size_t frame_count = 0;
+
+	profiler.setThreadName("simulation");
+
+	while (true)
+	{
+		PoseFrame &frame = frames.back();
+
+		frame.frame = frame_count++;
+		update(frame);
+		frames.publish();
+
+		// stay at most one frame ahead of the renderer
+		std::unique_lock<std::mutex> lock(mutex);
+		produced.notify_all();
+		consumed.wait(lock, [this]
+					  { return !running || (!frames.pending() && (!lockstep || submitted)); });
+		submitted = false;
+
+		if (!running)
+			break;
+	}
+}
+
+void Simulation::update(PoseFrame &frame)
+{
+	std::vector<std::function<void()>> pending;
+	std::vector<Animation> rest;
+	Frustum view;
+	vec view_eye;
+	float view_focal_length;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		pending.swap(commands);
+		rest = rest_pose;
+		view = frustum;
+		view_eye = eye;
+		view_focal_length = focal_length;
+	}
+
+	for (std::function<void()> &command : pending)
+		command();
+
+	size_t steps;
+
+	// the first frame always shows t = 0
+	if (frame_time > 0.0)
+		steps = frame.frame > 0 ? clock.advance(frame_time) : 0;
+	else
+		steps = clock.advance();
+
+	{
+		PROFILE_SCOPE(StepZone);
+
+		for (size_t step = 0; step < steps; step++)
+		{
+			advanceStateMachine(clock.getStep());
+			for (size_t id = 0; id < instances.size(); id++)
+				stepInstance(id, clock.getStep());
+		}
+	}
+
+	float alpha = clock.getAlpha();
+	const Playback &hero = instances[0].playback;
+
+	if (cull_instances)
+		view.cull(bounds, visible);
+	else
+		visible.assign(instances.size(), 1);
+
+	visible_instances.clear();
+	for (size_t i = 0; i < instances.size(); i++)
+		if (visible[i])
+			visible_instances.push_back(i);
+
+	frame.tick = clock.getTicks();
+	frame.playing = hero.isPlaying();
+	frame.time = hero.time;
+	frame.duration = hero.getDuration();
+	frame.state = machine != nullptr ? machine_states[0] : NO_TRANSITION;
+	frame.instance_count = visible_instances.size();
+	frame.culled = instances.size() - visible_instances.size();
+	frame.instance_rigs.resize(frame.instance_count);
+	frame.first_bones.resize(frame.instance_count);
+	frame.meshes.clear();
+	frame.gpu = gpu_poses && std::all_of(visible_instances.begin(), visible_instances.end(), [this, alpha](size_t id)
+										 { return isGpuEvaluable(instances[id], alpha); });
+
+	for (size_t i = 0; i < frame.instance_count; i++)
+	{
+		const Skeleton &rig = rigs[instances[visible_instances[i]].rig];
+
+		frame.instance_rigs[i] = instances[visible_instances[i]].rig;
+		frame.first_bones[i] = frame.meshes.size();
+		frame.meshes.insert(frame.meshes.end(), rig.meshes.begin(), rig.meshes.end());
+	}
+	frame.total_bones = frame.meshes.size();
+	std::fill(std::begin(frame.lod_instances), std::end(frame.lod_instances), 0);
+
+	// the editor follows the first instance even when it is off-screen
+	frame.locals = samplePose(instances[0], alpha, rest);
+
+	// the GPU evaluates everything at full rate anyway
+	if (frame.gpu)
+	{
+		frame.lod_instances[0] = frame.instance_count;
+		evaluateOnGpu(frame, rest, alpha);
+		return;
+	}
+
+	frame.transforms.resize(16 * frame.total_bones);
+	frame.colors.resize(3 * frame.total_bones);
+
+	for (size_t i = 0; i < frame.instance_count; i++)
+	{
+		size_t id = visible_instances[i];
+		Instance &instance = instances[id];
+		const Playback &playback = instance.playback;
+		const Skeleton &rig = rigs[instance.rig];
+		float *transforms = &frame.transforms[16 * frame.first_bones[i]];
+		float *colors = &frame.colors[3 * frame.first_bones[i]];
+		float t = playback.isPlaying() ? playback.sampleTime(alpha, clock.getStep()) : 0.0f;
+		size_t level = distant_lod && view_focal_length > 0.0f ? getLod(id, view_eye, view_focal_length) : 0;
+
+		frame.lod_instances[level]++;
+
+		// spread the evaluations of each level over its frames
+		if ((frame.frame + id) % (1 << level) != 0 && extrapolate(instance, frame.frame, 1 << level, t, transforms, colors))
+		{
+			bounds.fit(id, transforms, rig.size(), CULL_MARGIN);
+			continue;
+		}
+
+		// baked clips skip keyframe sampling entirely, unless something is blended over them, feet are
+		// planted or a loop is blending back into the first keyframe, which was not baked
+		if (playback.baked != nullptr && !instance.blender.isActive() && !plant_feet && t <= playback.getDuration())
+		{
+			PROFILE_SCOPE(SampleZone);
+
+			playback.baked->sample(t, getPosition(instance, alpha), transforms, colors);
+		}
+		else
+		{
+			std::vector<Animation> locals = id == 0 ? frame.locals : samplePose(instance, alpha, rest);
+			PROFILE_SCOPE(PropagateZone);
+
+			computeWorldTransforms(rig, locals, getPosition(instance, alpha), transforms);
+
+			for (size_t bone = 0; bone < rig.size(); bone++)
+			{
+				const vec color = locals[bone].getColor();
+
+				for (size_t c = 0; c < 3; c++)
+					colors[3 * bone + c] = color[c];
+			}
+		}
+
+		bounds.fit(id, transforms, rig.size(), CULL_MARGIN);
+
+		PoseHistory &history = instance.history;
+
+		if (level == 0)
+		{
+			history.count = 0;
+			continue;
+		}
+
+		if (history.clip != playback.clip)
+			history.count = 0;
+
+		std::swap(history.transforms[0], history.transforms[1]);
+		history.transforms[1].assign(transforms, transforms + 16 * rig.size());
+		history.colors.assign(colors, colors + 3 * rig.size());
+		history.times[0] = history.times[1];
+		history.times[1] = t;
+		history.clip = playback.clip;
+		history.frame = frame.frame;
+		history.count = std::min(history.count + 1, (size_t)2);
+	}
+}
+
+// The bounds follow the root motion too, since culled instances and poses evaluated on the
+// GPU are not fitted again until they are drawn from the CPU
+void Simulation::stepInstance(size_t id, float dt)
+{
+	Instance &instance = instances[id];
+	float motion[3];
+
+	instance.playback.step(dt, extract_root_motion ? motion : nullptr);
+	instance.blender.step(dt);
+
+	if (!extract_root_motion)
+		return;
+
+	for (size_t c = 0; c < 3; c++)
+		instance.offset[c] += motion[c];
+	bounds.x[id] += motion[0];
+	bounds.y[id] += motion[1];
+	bounds.z[id] += motion[2];
+}
+
+// Where the root of the clip is drawn from alpha of the way into the next step. The steps so far
+// have moved the offset by the root motion up to the playhead, so that much is taken back out of
+// the pose: the root stays where the clip starts, plus however it moves from the playhead on.
+vec Simulation::getPosition(const Instance &instance, float alpha) const
+{
+	const Playback &playback = instance.playback;
+	vec position = instance.offset;
+	float motion[3], start[3], now[3];
+
+	if (!extract_root_motion || !playback.isPlaying())
+		return position;
+
+	float t = playback.sampleTime(alpha, clock.getStep(), motion);
+
+	playback.sampleRoot(0.0f, start);
+	playback.sampleRoot(t, now);
+	position[0] += start[0] + motion[0] - now[0];
+	position[2] += start[2] + motion[2] - now[2];
+
+	return position;
+}
+
+// Rigs the clip of the state was not made for are retargeted, or keep their rest pose
+void Simulation::enterState(size_t instance, uint32_t state, float crossfade)
+{
+	const State &target = machine->states[state];
+	Instance &entering = instances[instance];
+	std::shared_ptr<const RetargetMap> retarget = state_retargets[state * rigs.size() + entering.rig];
+
+	machine_states[instance] = state;
+	state_times[instance] = 0.0f;
+	fadeOut(entering, crossfade);
+	entering.retarget = retarget;
+	if (rigs[entering.rig].size() != target.bone_count && retarget == nullptr)
+		return entering.playback.stop();
+
+	entering.playback.play(target.clip, nullptr, nullptr, target.tracks);
+	entering.playback.setMode(target.mode);
+}
+
+// Takes at most one transition per instance and step, before the step so that a clip
+// reaching its end hands over to the next state without showing the rest pose in between
+void Simulation::advanceStateMachine(float dt)
+{
+	if (machine == nullptr)
+		return;
+
+	size_t parameter_count = machine->defaults.size();
+
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		uint32_t transition = machine->next(machine_states[i], state_times[i], instances[i].playback, &machine_parameters[i * parameter_count], dt);
+
+		state_times[i] += dt;
+		if (transition != NO_TRANSITION)
+			enterState(i, machine->transitions[transition].target, machine->transitions[transition].duration);
+	}
+}
+
+// From the rig the clip was made for, the first one with as many bones, to the given one.
+// nullptr when the clip was made for that rig, or when they share no bone.
+std::shared_ptr<const RetargetMap> Simulation::getRetarget(size_t bone_count, size_t rig) const
+{
+	auto source = std::find_if(rigs.begin(), rigs.end(), [bone_count](const Skeleton &skeleton)
+							   { return skeleton.size() == bone_count; });
+
+	if (rigs[rig].size() == bone_count || source == rigs.end())
+		return nullptr;
+
+	std::shared_ptr<RetargetMap> map = std::make_shared<RetargetMap>(getRetargetMap(*source, rigs[rig]));
+
+	return map->isCompatible() ? map : nullptr;
+}
+
+// The fading pose is blended into one of the instance's rig, so a retargeted clip is cut instead
+void Simulation::fadeOut(Instance &instance, float duration)
+{
+	if (instance.retarget != nullptr)
+		instance.blender.stopFade();
+	else
+		instance.blender.crossfade(instance.playback, duration);
+}
+
+// Local pose of an instance alpha of the way into the next step, with its crossfade and
+// layers blended in
+std::vector<Animation> Simulation::samplePose(Instance &instance, float alpha, const std::vector<Animation> &rest)
+{
+	PROFILE_SCOPE(SampleZone);
+
+	const Playback &playback = instance.playback;
+	const std::vector<Animation> &still = instance.rig == 0 ? rest : rigs[instance.rig].bind_pose;
+	float t = playback.isPlaying() ? playback.sampleTime(alpha, clock.getStep()) : 0.0f;
+	std::vector<Animation> pose;
+
+	// a clip made for another rig is sampled whole, then remapped
+	if (!playback.isPlaying())
+		pose = still;
+	else if (instance.retarget != nullptr)
+		pose = retargetPose(playback.sample(t), *instance.retarget, still);
+
+	if (instance.blender.isActive())
+	{
+		std::vector<float> channels(12 * still.size());
+
+		if (pose.empty())
+			playback.sample(t, channels.data());
+		else
+			flattenPose(pose, channels.data());
+		instance.blender.blend(channels.data(), still.size(), alpha, clock.getStep());
+		pose = unflattenPose(channels.data(), still.size());
+	}
+	else if (pose.empty())
+		pose = playback.sample(t);
+
+	if (plant_feet)
+		plantFeet(instance, pose);
+
+	return pose;
+}
+
+// Lifts the feet that went through the floor back onto it, bending the legs to reach
+void Simulation::plantFeet(const Instance &instance, std::vector<Animation> &pose) const
+{
+	const Skeleton &rig = rigs[instance.rig];
+
+	for (size_t i = 0; i < feet[instance.rig].size(); i++)
+	{
+		IkChain chain = feet[instance.rig][i];
+		float end[3];
+
+		chain.solver = foot_solver;
+		getChainEnd(rig, pose, instance.offset, chain, end);
+		if (end[1] >= instance.offset[1] + floors[instance.rig][i])
+			continue;
+
+		end[1] = instance.offset[1] + floors[instance.rig][i];
+		solveIk(rig, pose, instance.offset, chain, end);
+	}
+}
+
+// From the screen space height of the instance's bounding sphere; the editable instance
+// always gets the full rate
+size_t Simulation::getLod(size_t instance, const vec &eye, float focal_length) const
+{
+	const float sizes[] = LOD_SCREEN_SIZES;
+	float dx = bounds.x[instance] - eye[0];
+	float dy = bounds.y[instance] - eye[1];
+	float dz = bounds.z[instance] - eye[2];
+	float size = bounds.radius[instance] * focal_length / sqrtf(dx * dx + dy * dy + dz * dz);
+	size_t level = 0;
+
+	if (instance == 0)
+		return 0;
+
+	while (level < LOD_LEVELS - 1 && size < sizes[level])
+		level++;
+
+	return level;
+}
+
+// Continues the motion between the last two evaluated poses, transforms element-wise and
+// in sample time so that pausing or scaling time holds or slows it down. Colors are held.
+// Fails when there is nothing recent to continue from: a different clip, time going back
+// because the clip looped or was seeked, or a pose older than the interval (the instance
+// was culled or evaluated at full rate meanwhile).
+bool Simulation::extrapolate(const Instance &instance, size_t frame, size_t interval, float time, float *transforms, float *colors) const
+{
+	const PoseHistory &history = instance.history;
+
+	if (history.count < 2 || history.clip != instance.playback.clip || time < history.times[1] || frame - history.frame >= interval)
+		return false;
+
+	float span = history.times[1] - history.times[0];
+	float factor = span > 0.0f ? (time - history.times[1]) / span : 0.0f;
+	const float *previous = history.transforms[0].data();
+	const float *last = history.transforms[1].data();
+
+	for (size_t i = 0; i < history.transforms[1].size(); i++)
+		transforms[i] = last[i] + (last[i] - previous[i]) * factor;
+
+	std::copy(history.colors.begin(), history.colors.end(), colors);
+
+	return true;
+}
+
+// The compute shader samples the keyframes of one clip linearly, bone for bone, and nothing
+// else: no crossfade or layer, no foot planting, no retargeting and no segment looping back
+bool Simulation::isGpuEvaluable(const Instance &instance, float alpha) const
+{
+	const Playback &playback = instance.playback;
+
+	if (plant_feet || instance.blender.isActive())
+		return false;
+	if (!playback.isPlaying())
+		return true;
+
+	return instance.retarget == nullptr && (playback.tracks == nullptr || playback.tracks->tracks[0].interpolation == Linear) &&
+		   playback.sampleTime(alpha, clock.getStep()) <= playback.getDuration();
+}
+
+void Simulation::evaluateOnGpu(PoseFrame &frame, const std::vector<Animation> &rest, float alpha)
+{
+	frame.clips.clear();
+	frame.instance_clips.resize(frame.instance_count);
+	frame.instance_times.resize(frame.instance_count);
+	frame.offsets.resize(3 * frame.instance_count);
+	frame.rest = rest;
+
+	for (size_t i = 0; i < frame.instance_count; i++)
+	{
+		const Instance &instance = instances[visible_instances[i]];
+		const Playback &playback = instance.playback;
+
+		for (size_t c = 0; c < 3; c++)
+			frame.offsets[3 * i + c] = instance.offset[c];
+
+		frame.instance_clips[i] = -1;
+		frame.instance_times[i] = playback.isPlaying() ? playback.sampleTime(alpha, clock.getStep()) : 0.0f;
+
+		if (!playback.isPlaying())
+			continue;
+
+		vec position = getPosition(instance, alpha);
+
+		for (size_t c = 0; c < 3; c++)
+			frame.offsets[3 * i + c] = position[c];
+
+		// instances almost always share the same clip
+		auto clip = std::find(frame.clips.begin(), frame.clips.end(), playback.clip);
+
+		frame.instance_clips[i] = clip - frame.clips.begin();
+		if (clip == frame.clips.end())
+			frame.clips.push_back(playback.clip);
+	}
+}
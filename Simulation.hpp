@@ -0,0 +1,228 @@
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "Clock.hpp"
+#include "Frustum.hpp"
+#include "InverseKinematics.hpp"
+#include "PoseBlender.hpp"
+#include "Retarget.hpp"
+#include "settings.hpp"
+#include "Skeleton.hpp"
+#include "StateMachine.hpp"
+#include "TripleBuffer.hpp"
+
+// Everything the render thread needs to draw one frame
+struct PoseFrame
+{
+	size_t frame;
+	size_t tick;
+	size_t instance_count; // visible ones only, culled instances are left out entirely
+	size_t culled;
+	size_t lod_instances[LOD_LEVELS]; // visible instances evaluated at each level of detail
+	size_t total_bones;
+	std::vector<size_t> instance_rigs;
+	std::vector<size_t> first_bones; // where each instance starts in transforms and colors
+	std::vector<MeshType> meshes;	 // one per bone
+	bool playing;
+	float time;
+	float duration;
+	uint32_t state; // of the first instance in the state machine, NO_TRANSITION without one
+	std::vector<Animation> locals; // local pose of the first (editable) instance
+	std::vector<float> transforms; // 16 floats per bone, instance after instance
+	std::vector<float> colors;	   // 3 floats per bone, instance after instance
+
+	// filled instead of transforms and colors when poses are evaluated on the GPU, which is
+	// only when every visible instance can be, see Simulation::isGpuEvaluable
+	bool gpu;
+	std::vector<std::shared_ptr<const Animations>> clips; // every clip sampled this frame
+	std::vector<int> instance_clips;					  // index in clips, -1 for the rest pose
+	std::vector<float> instance_times;
+	std::vector<float> offsets; // 3 floats per instance
+	std::vector<Animation> rest; // of the first rig, the others rest in their bind pose
+};
+
+// Last two poses evaluated for an instance at a reduced level of detail, extrapolated
+// on the frames in between
+struct PoseHistory
+{
+	std::shared_ptr<const Animations> clip;
+	size_t count; // poses held, up to 2
+	size_t frame; // of the last one
+	float times[2];
+	std::vector<float> transforms[2];
+	std::vector<float> colors;
+
+	PoseHistory();
+};
+
+// The settings last asked for, as the editor shows them. Only the render thread reads or
+// writes these; each change is also posted to the simulation thread, which applies it to
+// its own state (clock, gpu_poses, cull_instances...) between steps.
+struct SimulationSettings
+{
+	bool paused;
+	double time_scale;
+	PlaybackMode mode;
+	bool gpu;
+	bool culling;
+	bool lod;
+	float crossfade;
+	bool planting;
+	IkSolver ik_solver;
+	bool root_motion;
+
+	SimulationSettings();
+};
+
+struct Instance
+{
+	vec offset; // moved along by root motion
+	size_t rig;
+	Playback playback;
+	PoseBlender blender;
+	std::shared_ptr<const RetargetMap> retarget; // when the clip played was made for another rig
+	PoseHistory history;
+};
+
+// Evaluates the poses of every instance on its own thread, one frame ahead of the renderer.
+// The crowd cycles through the given rigs; the first instance always uses the first rig.
+// Clips made for one rig drive the others through their bones of the same name.
+// The render thread only ever reads the latest complete frame through acquire(), and
+// drives playback by posting commands that are applied between fixed steps.
+// Instances whose bounds fall outside the frustum last set are neither evaluated nor drawn,
+// and the smaller an instance is on screen the less often its pose is evaluated.
+// Switching clips fades the previous one out, and layers are blended over every instance.
+// A state machine, when set, switches the clip of each instance on its own instead.
+// Feet can be kept from going through the floor with inverse kinematics on the legs.
+// With root motion, the horizontal motion of the root of each clip moves the instance itself,
+// so that it keeps walking on from where a loop ends instead of snapping back.
+class Simulation
+{
+private:
+	std::vector<Skeleton> rigs;
+	std::vector<Instance> instances;
+	Clock clock;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable consumed;
+	std::condition_variable produced;
+	bool running;
+	double frame_time;
+	bool lockstep;
+	bool submitted;
+
+	// shared with the render thread, under mutex
+	std::vector<std::function<void()>> commands;
+	std::vector<Animation> rest_pose;
+	Frustum frustum;
+	vec eye;
+	float focal_length;
+
+	// owned by the simulation thread, changed through post()
+	bool gpu_poses;
+	float crossfade_duration;
+	bool plant_feet;
+	IkSolver foot_solver;
+	std::vector<std::vector<IkChain>> feet; // per rig
+	std::vector<std::vector<float>> floors; // per rig and foot, height of the end of the chain above the offset
+	bool extract_root_motion;
+	bool cull_instances;
+	bool distant_lod;
+	BoundingSpheres bounds; // from the last evaluated pose of each instance
+	std::vector<uint8_t> visible;
+	std::vector<size_t> visible_instances;
+
+	std::shared_ptr<const StateMachine> machine;
+	std::vector<uint32_t> machine_states; // one per instance
+	std::vector<float> state_times;
+	std::vector<float> machine_parameters; // parameter after parameter, instance after instance
+	std::vector<std::shared_ptr<const RetargetMap>> state_retargets; // rig after rig, state after state
+
+	TripleBuffer<PoseFrame> frames;
+	bool has_frame;
+
+	SimulationSettings settings; // render thread only
+
+	void run();
+	void update(PoseFrame &frame);
+	std::shared_ptr<const RetargetMap> getRetarget(size_t bone_count, size_t rig) const;
+	void fadeOut(Instance &instance, float duration);
+	void enterState(size_t instance, uint32_t state, float crossfade);
+	void advanceStateMachine(float dt);
+	void stepInstance(size_t id, float dt);
+	vec getPosition(const Instance &instance, float alpha) const;
+	std::vector<Animation> samplePose(Instance &instance, float alpha, const std::vector<Animation> &rest);
+	void plantFeet(const Instance &instance, std::vector<Animation> &pose) const;
+	size_t getLod(size_t instance, const vec &eye, float focal_length) const;
+	bool extrapolate(const Instance &instance, size_t frame, size_t interval, float time, float *transforms, float *colors) const;
+	bool isGpuEvaluable(const Instance &instance, float alpha) const;
+	void evaluateOnGpu(PoseFrame &frame, const std::vector<Animation> &rest, float alpha);
+	void post(std::function<void()> command);
+
+public:
+	Simulation(const std::vector<Skeleton> &rigs, size_t crowd_size);
+	~Simulation();
+
+	void start();
+	void stop();
+	void setFrameTime(double frame_time);
+	void setLockstep(bool lockstep);
+	void submit();
+
+	void play(std::shared_ptr<const Animations> clip, std::shared_ptr<const BakedClip> baked = nullptr,
+			  std::shared_ptr<const CompressedClip> compressed = nullptr, Interpolation interpolation = Linear);
+	void stopAnimation();
+	void setStateMachine(std::shared_ptr<const StateMachine> machine);
+	void setParameter(size_t parameter, float value);
+	void setParameter(size_t instance, size_t parameter, float value);
+	void addLayer(std::shared_ptr<const Animations> clip, float weight, bool additive, Interpolation interpolation = Linear,
+				  const std::vector<std::string> &mask = {});
+	void setLayerWeight(size_t layer, float weight);
+	void clearLayers();
+	void seek(float time);
+	void step();
+
+	bool isPaused() const;
+	void setPaused(bool paused);
+	void setPaused(size_t instance, bool paused);
+	double getTimeScale() const;
+	void setTimeScale(double scale);
+	void setTimeScale(size_t instance, float scale);
+	PlaybackMode getPlaybackMode() const;
+	void setPlaybackMode(PlaybackMode mode);
+	void setPlaybackMode(size_t instance, PlaybackMode mode);
+	float getCrossfade() const;
+	void setCrossfade(float duration);
+
+	bool isPlantingFeet() const;
+	void setPlantingFeet(bool planting);
+	IkSolver getFootSolver() const;
+	void setFootSolver(IkSolver solver);
+
+	bool isRootMotionEnabled() const;
+	void setRootMotionEnabled(bool enabled);
+
+	bool isGpuEvaluated() const;
+	void setGpuEvaluated(bool gpu);
+
+	bool isCulling() const;
+	void setCulling(bool culling);
+	bool isLodEnabled() const;
+	void setLodEnabled(bool lod);
+	void setView(const mat &view, const mat &projection, const vec &eye);
+
+	void setRestPose(const std::vector<Animation> &pose);
+	const Skeleton &getSkeleton() const;
+	const std::vector<Skeleton> &getRigs() const;
+
+	const PoseFrame *acquire();
+	const PoseFrame *acquireNext();
+	const PoseFrame *latest() const;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include "Skeleton.hpp"
+#include "settings.hpp"
+
+size_t Skeleton::size() const
+{
+	return parents.size();
+}
+
+int Skeleton::addBone(const std::string &name, int parent, vec dims, vec jointPos, vec jointRot, vec color, MeshType mesh)
+{
+	names.push_back(name);
+	parents.push_back(parent);
+	bind_pose.push_back(Animation(jointPos, jointRot, dims, color));
+	meshes.push_back(mesh);
+
+	return parents.size() - 1;
+}
+
+// Bones are added in pre-order so the indices match the order of the keyframes in .anim files
+Skeleton createSkeleton(ModelType model_type)
+{
+	Skeleton skeleton;
+
+	int torso = skeleton.addBone("torso", -1, vec({1, 2, 0.5}), vec({0, 0, 0}), vec(3), TORSO_COLOR);
+	int leftBicep = skeleton.addBone("leftBicep", torso, vec({0.3, 2.2, 0.3}), vec({0.5, 0.8, 0}), rotationToEuler(rotate(M_PI_2, vec({0, 0, 1}))), LEFT_ARM_COLOR);
+	skeleton.addBone("leftForeArm", leftBicep, vec({0.3, 0.3, 0.3}), vec({0, 1, 0}), vec(3), LEFT_FOREARM_COLOR);
+	int rightBicep = skeleton.addBone("rightBicep", torso, vec({0.3, 2.2, 0.3}), vec({-0.5, 0.8, 0}), rotationToEuler(rotate(-M_PI_2, vec({0, 0, 1}))), RIGHT_ARM_COLOR);
+	skeleton.addBone("rightForeArm", rightBicep, vec({0.3, 0.3, 0.3}), vec({0, 1, 0}), vec(3), RIGHT_FOREARM_COLOR);
+	int leftThigh = skeleton.addBone("leftThigh", torso, vec({0.3, 2.5, 0.3}), vec({-0.4, 0, 0}), rotationToEuler(rotate(M_PI, vec({1, 0, 0}))), LEFT_THIGH_COLOR);
+	skeleton.addBone("leftCalf", leftThigh, vec({0.4, 0.3, 0.8}), vec({0, 1, 0}), vec(3), LEFT_CALF_COLOR);
+	int rightThigh = skeleton.addBone("rightThigh", torso, vec({0.3, 2.5, 0.3}), vec({0.4, 0, 0}), rotationToEuler(rotate(M_PI, vec({1, 0, 0}))), RIGHT_THIGH_COLOR);
+	skeleton.addBone("rightCalf", rightThigh, vec({0.4, 0.3, 0.8}), vec({0, 1, 0}), vec(3), RIGHT_CALF_COLOR);
+	int head = skeleton.addBone("head", torso, vec({0.5, 0.5, 0.5}), vec({0, 1, 0}), vec(3), HEAD_COLOR);
+
+	if (model_type == Alien)
+	{
+		skeleton.addBone("leftAntenna", head, vec({0.1, 1.5, 0.1}), vec({0.2, 0.5, 0}), vec(3), LEFT_ANTENNA_COLOR);
+		skeleton.addBone("rightAntenna", head, vec({0.1, 1.5, 0.1}), vec({-0.2, 0.5, 0}), vec(3), RIGHT_ANTENNA_COLOR);
+	}
+
+	return skeleton;
+}
+
+// Parents come before their children, so a single pass finds every descendant
+BoneMask getBoneMask(const Skeleton &skeleton, const std::vector<std::string> &roots)
+{
+	BoneMask mask(skeleton.size());
+
+	for (size_t i = 0; i < skeleton.size(); i++)
+	{
+		int parent = skeleton.parents[i];
+
+		if ((parent >= 0 && mask.test(parent)) || std::find(roots.begin(), roots.end(), skeleton.names[i]) != roots.end())
+			mask.set(i);
+	}
+
+	return mask;
+}
+
+static vec clampDims(vec dims)
+{
+	for (int i = 0; i < 3; i++)
+		if (dims[i] < 0.0000000000001)
+			dims[i] = 0.0000000000001;
+	return dims;
+}
+
+void computeWorldTransforms(const Skeleton &skeleton, const std::vector<Animation> &locals, const vec &offset, float *out)
+{
+	std::vector<mat> world(skeleton.size());
+
+	for (size_t i = 0; i < skeleton.size(); i++)
+	{
+		int parent = skeleton.parents[i];
+		vec dims = clampDims(locals[i].getScale());
+		mat localTransform;
+
+		if (parent >= 0)
+		{
+			vec parent_dims = clampDims(locals[parent].getScale());
+			localTransform = scale(dims) * eulerToRotation(locals[i].getRotation(), 4) * scale(vec({1 / parent_dims[0], 1 / parent_dims[1], 1 / parent_dims[2]})) * translate(locals[i].getTranslation());
+			world[i] = localTransform * world[parent];
+		}
+		else
+		{
+			localTransform = scale(dims) * eulerToRotation(locals[i].getRotation(), 4) * translate(locals[i].getTranslation());
+			world[i] = localTransform * translate(offset);
+		}
+
+		for (size_t row = 0; row < 4; row++)
+			for (size_t col = 0; col < 4; col++)
+				out[16 * i + 4 * row + col] = world[i][row][col];
+	}
+}
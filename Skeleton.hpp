@@ -0,0 +1,45 @@
+#ifndef SKELETON_HPP
+#define SKELETON_HPP
+
+#include <string>
+#include <vector>
+#include "ft_vec.hpp"
+#include "ft_mat.hpp"
+#include "Animation.hpp"
+
+typedef ft::matrix<float> mat;
+
+typedef enum ModelType {
+	Human = 0,
+	Alien
+} ModelType;
+
+// Geometry drawn for a bone, see Renderer
+typedef enum MeshType {
+	Cube = 0,
+	MeshTypeCount
+} MeshType;
+
+// Flat bone hierarchy, in the same pre-order as the keyframes of a .anim file.
+// It holds no GL state so it can be evaluated away from the render thread or without a display.
+struct Skeleton
+{
+	std::vector<std::string> names;
+	std::vector<int> parents;
+	std::vector<Animation> bind_pose;
+	std::vector<MeshType> meshes;
+
+	size_t size() const;
+	int addBone(const std::string &name, int parent, vec dims, vec jointPos, vec jointRot, vec color, MeshType mesh = Cube);
+};
+
+Skeleton createSkeleton(ModelType model_type);
+
+// The named bones and everything below them; names the skeleton does not have are ignored
+BoneMask getBoneMask(const Skeleton &skeleton, const std::vector<std::string> &roots);
+
+// Writes one row-major 4x4 world matrix per bone (16 floats each) into out,
+// placing the root at offset; mirrors Bone::applyTransforms.
+void computeWorldTransforms(const Skeleton &skeleton, const std::vector<Animation> &locals, const vec &offset, float *out);
+
+#endif
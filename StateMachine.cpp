@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "StateMachine.hpp"
+
+// First transition of the state whose condition holds before stepping by dt, if any
+uint32_t StateMachine::next(uint32_t state, float state_time, const Playback &playback, const float *parameters, float dt) const
+{
+	const State &current = states[state];
+
+	for (uint32_t i = current.first_transition; i < current.first_transition + current.transition_count; i++)
+	{
+		const Transition &transition = transitions[i];
+		bool passed = false;
+
+		switch (transition.condition)
+		{
+		case End:
+			passed = playback.reachesEnd(dt);
+			break;
+		case After:
+			passed = state_time >= transition.value;
+			break;
+		case Above:
+			passed = parameters[transition.parameter] > transition.value;
+			break;
+		case Below:
+			passed = parameters[transition.parameter] < transition.value;
+			break;
+		}
+
+		if (passed)
+			return i;
+	}
+
+	return NO_TRANSITION;
+}
+
+static std::vector<std::string> tokenize(const std::string &line)
+{
+	std::istringstream stream(line);
+	std::vector<std::string> tokens;
+	std::string token;
+
+	while (stream >> std::quoted(token))
+		tokens.push_back(token);
+
+	return tokens;
+}
+
+static uint32_t findName(const std::vector<std::string> &names, const std::string &name)
+{
+	auto it = std::find(names.begin(), names.end(), name);
+
+	return it == names.end() ? NO_TRANSITION : it - names.begin();
+}
+
+static PlaybackMode findMode(const std::string &name)
+{
+	for (size_t i = 0; i < PlaybackModeCount; i++)
+		if (name == getPlaybackModeName((PlaybackMode)i))
+			return (PlaybackMode)i;
+
+	return PlaybackModeCount;
+}
+
+static bool parseNumber(const std::string &token, float &value)
+{
+	try
+	{
+		size_t length;
+
+		value = std::stof(token, &length);
+
+		return length == token.size();
+	}
+	catch (std::exception &e)
+	{
+		return false;
+	}
+}
+
+// Transitions can name states declared after them, so they are compiled once every state is known
+static bool compileTransition(StateMachine &machine, const std::vector<std::string> &tokens, uint32_t &from, Transition &transition)
+{
+	if (tokens.size() < 5)
+		return false;
+
+	from = findName(machine.state_names, tokens[1]);
+	transition.target = findName(machine.state_names, tokens[2]);
+	transition.parameter = 0;
+	transition.value = 0.0f;
+
+	if (from == NO_TRANSITION || transition.target == NO_TRANSITION || !parseNumber(tokens[3], transition.duration))
+		return false;
+
+	if (tokens[4] == "end")
+	{
+		transition.condition = End;
+		return tokens.size() == 5;
+	}
+
+	if (tokens[4] == "after")
+	{
+		transition.condition = After;
+		return tokens.size() == 6 && parseNumber(tokens[5], transition.value);
+	}
+
+	transition.parameter = findName(machine.parameter_names, tokens[4]);
+	transition.condition = tokens.size() > 5 && tokens[5] == "<" ? Below : Above;
+
+	return transition.parameter != NO_TRANSITION && tokens.size() == 7 && (tokens[5] == "<" || tokens[5] == ">") &&
+		   parseNumber(tokens[6], transition.value);
+}
+
+std::shared_ptr<const StateMachine> loadStateMachine(const std::string &path, const std::map<std::string, Animations> &animations,
+													  Interpolation interpolation)
+{
+	std::ifstream file(path);
+
+	if (!file.is_open())
+	{
+		std::cerr << "State machine " << path << " not found" << std::endl;
+		return nullptr;
+	}
+
+	return loadStateMachine(file, path, animations, interpolation);
+}
+
+std::shared_ptr<const StateMachine> loadStateMachine(std::istream &file, const std::string &path,
+													  const std::map<std::string, Animations> &animations, Interpolation interpolation)
+{
+	std::shared_ptr<StateMachine> machine = std::make_shared<StateMachine>();
+	std::vector<std::pair<size_t, std::vector<std::string>>> declarations;
+	std::string line;
+	size_t line_number = 0;
+
+	while (std::getline(file, line))
+	{
+		std::vector<std::string> tokens = tokenize(line);
+
+		machine->source += line + '\n';
+		line_number++;
+		if (tokens.empty() || tokens[0][0] == '#')
+			continue;
+
+		if (tokens[0] == "transition")
+		{
+			declarations.push_back({line_number, tokens});
+			continue;
+		}
+
+		float value;
+		auto clip = tokens.size() > 2 ? animations.find(tokens[2]) : animations.end();
+		PlaybackMode mode = tokens.size() == 4 ? findMode(tokens[3]) : Once;
+
+		if (tokens[0] == "parameter" && tokens.size() == 3 && parseNumber(tokens[2], value))
+		{
+			machine->parameter_names.push_back(tokens[1]);
+			machine->defaults.push_back(value);
+		}
+		else if (tokens[0] == "state" && (tokens.size() == 3 || tokens.size() == 4) && mode != PlaybackModeCount &&
+				 clip != animations.end() && clip->second.size() > 1)
+		{
+			State state;
+
+			state.clip = std::make_shared<const Animations>(clip->second);
+			state.tracks = importTracks(clip->second, interpolation);
+			state.bone_count = clip->second.begin()->second.size();
+			state.mode = mode;
+			state.first_transition = 0;
+			state.transition_count = 0;
+			machine->states.push_back(state);
+			machine->state_names.push_back(tokens[1]);
+		}
+		else
+		{
+			std::cerr << "State machine " << path << ": invalid line " << line_number << ": " << line << std::endl;
+			return nullptr;
+		}
+	}
+
+	if (machine->states.empty())
+	{
+		std::cerr << "State machine " << path << " has no state" << std::endl;
+		return nullptr;
+	}
+
+	std::vector<std::pair<uint32_t, Transition>> transitions;
+
+	for (const auto &[number, tokens] : declarations)
+	{
+		uint32_t from;
+		Transition transition;
+
+		if (!compileTransition(*machine, tokens, from, transition))
+		{
+			std::cerr << "State machine " << path << ": invalid transition on line " << number << std::endl;
+			return nullptr;
+		}
+		transitions.push_back({from, transition});
+	}
+
+	std::stable_sort(transitions.begin(), transitions.end(), [](const auto &a, const auto &b)
+					 { return a.first < b.first; });
+
+	for (const auto &[from, transition] : transitions)
+	{
+		State &state = machine->states[from];
+
+		if (state.transition_count == 0)
+			state.first_transition = machine->transitions.size();
+		state.transition_count++;
+		machine->transitions.push_back(transition);
+	}
+
+	std::cout << "State machine " << path << " loaded: " << machine->states.size() << " state(s), "
+			  << machine->transitions.size() << " transition(s)" << std::endl;
+
+	return machine;
+}
@@ -0,0 +1,63 @@
+#ifndef STATEMACHINE_HPP
+#define STATEMACHINE_HPP
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <memory>
+#include <string>
+#include "Clock.hpp"
+
+#define NO_TRANSITION UINT32_MAX
+
+typedef enum Condition {
+	End = 0, // the clip of the state reaches its end during the step, see Playback::reachesEnd
+	After,	 // the state has been active for value seconds
+	Above,	 // parameter > value
+	Below	 // parameter < value
+} Condition;
+
+struct State
+{
+	std::shared_ptr<const Animations> clip;
+	std::shared_ptr<const TrackClip> tracks;
+	size_t bone_count;
+	PlaybackMode mode;
+	uint32_t first_transition; // transitions of a state are contiguous, tested in file order
+	uint32_t transition_count;
+};
+
+struct Transition
+{
+	uint32_t target;
+	Condition condition;
+	uint32_t parameter;
+	float value;
+	float duration; // crossfade
+};
+
+// States and transitions compiled into flat arrays, indexed by integers: evaluating an
+// instance only reads its state, its time in the state and its parameters.
+// Described in a text file, one declaration per line, names with spaces between quotes:
+//     parameter <name> <default value>
+//     state <name> <clip> [<mode>]        the first one is where instances start, once|loop|ping-pong|clamp
+//     transition <from> <to> <crossfade seconds> end | after <seconds> | <parameter> > | < <value>
+struct StateMachine
+{
+	std::vector<State> states;
+	std::vector<Transition> transitions;
+	std::vector<float> defaults; // one per parameter
+	std::vector<std::string> state_names;
+	std::vector<std::string> parameter_names;
+	std::string source; // the text compiled, replays carry it instead of the path
+
+	uint32_t next(uint32_t state, float state_time, const Playback &playback, const float *parameters, float dt) const;
+};
+
+std::shared_ptr<const StateMachine> loadStateMachine(const std::string &path, const std::map<std::string, Animations> &animations,
+													  Interpolation interpolation = Linear);
+// Same from text already read, path only names it in errors
+std::shared_ptr<const StateMachine> loadStateMachine(std::istream &file, const std::string &path,
+													  const std::map<std::string, Animations> &animations, Interpolation interpolation = Linear);
+
+#endif
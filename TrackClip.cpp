@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cmath>
+#include "TrackClip.hpp"
+#include "settings.hpp"
+
+const char *getInterpolationName(Interpolation interpolation)
+{
+	const char *names[InterpolationCount] = {"step", "linear", "hermite", "catmull-rom"};
+
+	return interpolation < InterpolationCount ? names[interpolation] : "unknown";
+}
+
+// Slope of each component at every key, in value per second
+static std::vector<float> getTangents(const Track &track)
+{
+	size_t count = track.times.size();
+	std::vector<float> tangents(3 * count);
+
+	for (size_t key = 0; key < count; key++)
+	{
+		size_t previous = key > 0 ? key - 1 : key;
+		size_t next = key + 1 < count ? key + 1 : key;
+
+		for (size_t c = 0; c < 3; c++)
+		{
+			float p0 = track.values[3 * previous + c];
+			float p1 = track.values[3 * key + c];
+			float p2 = track.values[3 * next + c];
+			float h0 = track.times[key] - track.times[previous];
+			float h1 = track.times[next] - track.times[key];
+			float &tangent = tangents[3 * key + c];
+
+			if (track.interpolation == CatmullRom)
+			{
+				tangent = (p2 - p0) / (track.times[next] - track.times[previous]);
+				continue;
+			}
+
+			// one-sided at the ends, zero at extrema, weighted harmonic mean of the secants otherwise
+			float d0 = h0 > 0.0f ? (p1 - p0) / h0 : (p2 - p1) / h1;
+			float d1 = h1 > 0.0f ? (p2 - p1) / h1 : d0;
+
+			if (h0 == 0.0f || h1 == 0.0f)
+				tangent = h0 == 0.0f ? d1 : d0;
+			else if (d0 * d1 <= 0.0f)
+				tangent = 0.0f;
+			else
+				tangent = 3.0f * (h0 + h1) / ((2.0f * h1 + h0) / d0 + (h1 + 2.0f * h0) / d1);
+		}
+	}
+
+	return tangents;
+}
+
+// Precomputes the cubic of every segment, with u going from 0 to 1 across it
+void Track::fit()
+{
+	size_t segments = times.size() > 1 ? times.size() - 1 : 0;
+	std::vector<float> tangents;
+
+	if (interpolation == Hermite || interpolation == CatmullRom)
+		tangents = getTangents(*this);
+
+	coefficients.assign(12 * segments, 0.0f);
+
+	for (size_t segment = 0; segment < segments; segment++)
+	{
+		float h = times[segment + 1] - times[segment];
+
+		for (size_t c = 0; c < 3; c++)
+		{
+			float p0 = values[3 * segment + c];
+			float p1 = values[3 * (segment + 1) + c];
+			float *k = &coefficients[12 * segment + 4 * c];
+
+			k[3] = p0;
+			if (interpolation == Linear)
+				k[2] = p1 - p0;
+			else if (interpolation != Step)
+			{
+				float m0 = h * tangents[3 * segment + c];
+				float m1 = h * tangents[3 * (segment + 1) + c];
+
+				k[0] = 2.0f * (p0 - p1) + m0 + m1;
+				k[1] = 3.0f * (p1 - p0) - 2.0f * m0 - m1;
+				k[2] = m0;
+			}
+		}
+	}
+}
+
+// Holds the first and last values outside of the keys
+void Track::sample(float t, float *value) const
+{
+	if (t <= times.front() || t >= times.back())
+	{
+		size_t key = t <= times.front() ? 0 : times.size() - 1;
+
+		for (size_t c = 0; c < 3; c++)
+			value[c] = values[3 * key + c];
+		return;
+	}
+
+	size_t segment = std::upper_bound(times.begin(), times.end(), t) - times.begin() - 1;
+	float u = (t - times[segment]) / (times[segment + 1] - times[segment]);
+	const float *k = &coefficients[12 * segment];
+
+	for (size_t c = 0; c < 3; c++, k += 4)
+		value[c] = ((k[0] * u + k[1]) * u + k[2]) * u + k[3];
+}
+
+size_t TrackClip::keyCount() const
+{
+	size_t count = 0;
+
+	for (const Track &track : tracks)
+		count += track.times.size();
+
+	return count;
+}
+
+size_t TrackClip::bytes() const
+{
+	size_t total = sizeof(TrackClip) + tracks.capacity() * sizeof(Track);
+
+	for (const Track &track : tracks)
+		total += (track.times.capacity() + track.values.capacity() + track.coefficients.capacity()) * sizeof(float);
+
+	return total;
+}
+
+// 12 floats per bone, see flattenPose. The bones left out of the mask are not written.
+void TrackClip::sample(float t, float *channels, const BoneMask *mask) const
+{
+	for (size_t bone = 0; bone < bone_count; bone++)
+	{
+		if (mask != nullptr && !mask->test(bone))
+			continue;
+
+		for (size_t channel = 0; channel < 4; channel++)
+			tracks[4 * bone + channel].sample(t, &channels[12 * bone + 3 * channel]);
+	}
+}
+
+std::vector<Animation> TrackClip::sample(float t) const
+{
+	std::vector<float> channels(12 * bone_count);
+
+	sample(t, channels.data());
+
+	return unflattenPose(channels.data(), bone_count);
+}
+
+static vec getChannel(const Animation &animation, size_t channel)
+{
+	switch (channel)
+	{
+	case 0:
+		return animation.getTranslation();
+	case 1:
+		return animation.getRotation();
+	case 2:
+		return animation.getScale();
+	default:
+		return animation.getColor();
+	}
+}
+
+// Whether lerping between keys first and last of a channel reproduces every key in between
+static bool isReconstructed(const std::vector<float> &times, const std::vector<vec> &values, size_t first, size_t last)
+{
+	for (size_t key = first + 1; key < last; key++)
+	{
+		float alpha = (times[key] - times[first]) / (times[last] - times[first]);
+
+		for (size_t c = 0; c < 3; c++)
+			if (fabsf(values[first][c] + (values[last][c] - values[first][c]) * alpha - values[key][c]) > TRACK_IMPORT_TOLERANCE)
+				return false;
+	}
+
+	return true;
+}
+
+// Splits full-pose keyframes into one track per channel, keeping only the keys a channel
+// needs: the ones linear interpolation of its neighbours does not already give.
+// Curves through fewer keys would change shape, so the other modes only merge constant channels.
+std::shared_ptr<const TrackClip> importTracks(const Animations &clip, Interpolation interpolation)
+{
+	std::shared_ptr<TrackClip> tracks = std::make_shared<TrackClip>();
+	std::vector<float> times;
+
+	for (const auto &[time, pose] : clip)
+		times.push_back(time);
+
+	tracks->bone_count = clip.begin()->second.size();
+	tracks->duration = times.back();
+	tracks->tracks.resize(4 * tracks->bone_count);
+
+	for (size_t bone = 0; bone < tracks->bone_count; bone++)
+	{
+		for (size_t channel = 0; channel < 4; channel++)
+		{
+			Track &track = tracks->tracks[4 * bone + channel];
+			std::vector<vec> values;
+
+			for (const auto &[time, pose] : clip)
+				values.push_back(getChannel(pose[bone], channel));
+
+			bool constant = true;
+			std::vector<size_t> kept = {0};
+
+			for (const vec &value : values)
+				for (size_t c = 0; c < 3; c++)
+					constant = constant && fabsf(value[c] - values.front()[c]) <= TRACK_IMPORT_TOLERANCE;
+
+			// a channel that never moves is a single key
+			for (size_t key = 1; !constant && key < times.size(); key++)
+				if (key + 1 == times.size() || interpolation != Linear || !isReconstructed(times, values, kept.back(), key + 1))
+					kept.push_back(key);
+
+			for (size_t key : kept)
+			{
+				track.times.push_back(times[key]);
+				for (size_t c = 0; c < 3; c++)
+					track.values.push_back(values[key][c]);
+			}
+
+			track.interpolation = interpolation;
+			track.fit();
+		}
+	}
+
+	return tracks;
+}
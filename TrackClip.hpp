@@ -0,0 +1,46 @@
+#ifndef TRACKCLIP_HPP
+#define TRACKCLIP_HPP
+
+#include <memory>
+#include "Animation.hpp"
+
+typedef enum Interpolation {
+	Step = 0,
+	Linear,
+	Hermite,	// cubic, with tangents limited so that it never overshoots the keys
+	CatmullRom, // cubic, through every key with tangents from the neighbouring keys
+	InterpolationCount
+} Interpolation;
+
+const char *getInterpolationName(Interpolation interpolation);
+
+// Keys of one channel (translation, rotation, scale or color) of one bone, each at its own time.
+// Every mode is fitted into one cubic per segment and component, so sampling costs the same.
+struct Track
+{
+	Interpolation interpolation;
+	std::vector<float> times;
+	std::vector<float> values;		 // 3 per key
+	std::vector<float> coefficients; // 12 per segment: a, b, c, d of a u^3 + b u^2 + c u + d per component
+
+	void fit();
+	void sample(float t, float *value) const;
+};
+
+// A clip as independent tracks, 4 per bone in Animation order. A bone that does not move
+// costs one key per channel instead of one per keyframe of the clip.
+struct TrackClip
+{
+	size_t bone_count;
+	float duration;
+	std::vector<Track> tracks;
+
+	size_t keyCount() const;
+	size_t bytes() const;
+	void sample(float t, float *channels, const BoneMask *mask = nullptr) const;
+	std::vector<Animation> sample(float t) const;
+};
+
+std::shared_ptr<const TrackClip> importTracks(const Animations &clip, Interpolation interpolation = Linear);
+
+#endif
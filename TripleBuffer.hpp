@@ -0,0 +1,53 @@
+#ifndef TRIPLEBUFFER_HPP
+#define TRIPLEBUFFER_HPP
+
+#include <atomic>
+
+// Single producer / single consumer triple buffer.
+// The producer fills back() and publish()es it, the consumer acquire()s the latest
+// published slot and reads it through front(); neither side ever blocks the other.
+template <typename T>
+class TripleBuffer
+{
+private:
+	static const int INDEX_MASK = 0x3;
+	static const int DIRTY = 0x4;
+
+	T slots[3];
+	std::atomic<int> ready;
+	int back_index;
+	int front_index;
+
+public:
+	TripleBuffer() : ready(1), back_index(0), front_index(2) {}
+
+	T &back()
+	{
+		return slots[back_index];
+	}
+
+	const T &front() const
+	{
+		return slots[front_index];
+	}
+
+	void publish()
+	{
+		back_index = ready.exchange(back_index | DIRTY) & INDEX_MASK;
+	}
+
+	bool acquire()
+	{
+		if (!pending())
+			return false;
+		front_index = ready.exchange(front_index) & INDEX_MASK;
+		return true;
+	}
+
+	bool pending() const
+	{
+		return ready.load() & DIRTY;
+	}
+};
+
+#endif
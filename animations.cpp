@@ -1,7 +1,7 @@
 #include "humanGL.hpp"
 #include "imgui.h"
 
-void animationEditor(Bone *root)
+void animationEditor(Bone *root, Simulation &simulation)
 {
 	static string current_animation_name = string();
 	static float time = 0.0f;
@@ -16,11 +16,35 @@ void animationEditor(Bone *root)
 	ImGui::Separator();
 
 	animationCreationEditor(current_animation_name, time);
-	animationLoadEditor(root);
+	animationLoadEditor();
 
 	ImGui::Separator();
 
-	animationPlayEditor();
+	animationPlayEditor(simulation);
+
+	ImGui::Separator();
+
+	layerEditor(simulation);
+
+	ImGui::Separator();
+
+	stateMachineEditor(simulation);
+
+	ImGui::Separator();
+
+	poseCacheEditor(simulation);
+
+	ImGui::Separator();
+
+	compressionEditor();
+
+	ImGui::Separator();
+
+	cullingEditor(simulation);
+
+	ImGui::Separator();
+
+	footIkEditor(simulation);
 
 	ImGui::End();
 }
@@ -65,6 +89,9 @@ void currentAnimationEditor(Bone *root, string &current_animation_name, float &t
 	if (ImGui::Button("Save Keyframe"))
 	{
 		name_to_animations[current_animation_name].insert(std::make_pair(time, root->getAnimations()));
+		pose_cache.invalidate(current_animation_name);
+		clip_compressor.invalidate(current_animation_name);
+		recordClip(current_animation_name);
 		std::cout << "Saved keyframe for time " << time << std::endl;
 	}
 
@@ -73,13 +100,19 @@ void currentAnimationEditor(Bone *root, string &current_animation_name, float &t
 	{
 		std::cout << "Deleted keyframe for time " << current_animation_last_time << std::endl;
 		name_to_animations[current_animation_name].erase(current_animation_last_time);
+		pose_cache.invalidate(current_animation_name);
+		clip_compressor.invalidate(current_animation_name);
+		recordClip(current_animation_name);
 		setTimeToLastKeyframe(time, current_animation_name);
 	}
 	ImGui::EndDisabled();
 
 	if (ImGui::Button("Delete Animation"))
 	{
+		recordEvent(ReplayEvent(DeleteClipEvent, 0, {}, current_animation_name));
 		name_to_animations.erase(current_animation_name);
+		pose_cache.invalidate(current_animation_name);
+		clip_compressor.invalidate(current_animation_name);
 		current_animation_name = string();
 
 		return;
@@ -91,29 +124,6 @@ void currentAnimationEditor(Bone *root, string &current_animation_name, float &t
 	ImGui::EndDisabled();
 }
 
-void saveAnimations(const string name, const Animations &animations)
-{
-	std::ofstream file(name + ".anim");
-
-	if (!file.is_open())
-	{
-		std::cerr << "Could not open file " << name << std::endl;
-		return;
-	}
-
-	for (const auto &[time, animation] : animations)
-	{
-		file << time << "\n";
-		for (const auto &a : animation)
-			file << a << "\n";
-		file << "~";
-	}
-
-	file.close();
-
-	std::cout << "Animation " << name << " saved" << std::endl;
-}
-
 void animationCreationEditor(string &current_animation_name, float &time)
 {
 	static char new_animation_name[100] = "";
@@ -125,6 +135,7 @@ void animationCreationEditor(string &current_animation_name, float &time)
 		if (ImGui::Button("Create Animation"))
 		{
 			name_to_animations[new_animation_name] = Animations();
+			recordClip(new_animation_name);
 
 			if (!current_animation_name.empty())
 				setTimeToLastKeyframe(time, current_animation_name);
@@ -135,7 +146,7 @@ void animationCreationEditor(string &current_animation_name, float &time)
 	}
 }
 
-void animationLoadEditor(Bone *root)
+void animationLoadEditor()
 {
 	static char load_animation_name[100] = "";
 
@@ -145,7 +156,7 @@ void animationLoadEditor(Bone *root)
 	{
 		if (ImGui::Button("Load Animation"))
 		{
-			Animations animations = loadAnimations(load_animation_name, root->getChildrenCount());
+			Animations animations = loadModelAnimation(load_animation_name);
 
 			if (!animations.empty())
 			{
@@ -153,198 +164,506 @@ void animationLoadEditor(Bone *root)
 				string name = path.stem();
 
 				name_to_animations[name] = animations;
+				pose_cache.invalidate(name);
+				clip_compressor.invalidate(name);
+				recordClip(name);
 			}
 			load_animation_name[0] = '\0';
 		}
 	}
 }
 
-void animationPlayEditor()
+void animationPlayEditor(Simulation &simulation)
 {
+	float crossfade = simulation.getCrossfade();
+
 	ImGui::Text("Play Animation");
 
+	interpolationEditor();
+
+	if (ImGui::SliderFloat("Crossfade (s)", &crossfade, 0.0f, 2.0f))
+	{
+		recordEvent(ReplayEvent(CrossfadeEvent, 0, {crossfade}));
+		simulation.setCrossfade(crossfade);
+	}
+
 	for (auto &anim : name_to_animations)
 	{
 		if (anim.second.size() > 1 && ImGui::Button(anim.first.c_str()))
 		{
-			current_animation = &anim.second;
-			start_time = std::chrono::high_resolution_clock::now();
-			end_time = start_time + std::chrono::milliseconds((int)(anim.second.rbegin()->first * 1000));
+			recordEvent(ReplayEvent(PlayEvent, interpolation, {}, anim.first));
+			simulation.play(std::make_shared<const Animations>(anim.second), pose_cache.get(anim.first), clip_compressor.get(anim.first),
+							interpolation);
 			std::cout << "Playing animation " << anim.first << std::endl;
 		}
 	}
+
+	animationPlaybackEditor(simulation);
 }
 
-void setTimeToLastKeyframe(float &time, const string &current_animation_name)
+// Applies to the clips played from now on
+void interpolationEditor()
 {
-	if (!name_to_animations[current_animation_name].empty())
-		time = name_to_animations[current_animation_name].rbegin()->first;
-	else
-		time = 0.0f;
+	if (ImGui::BeginCombo("Interpolation", getInterpolationName(interpolation)))
+	{
+		for (size_t i = 0; i < InterpolationCount; i++)
+		{
+			bool is_selected = interpolation == (Interpolation)i;
+
+			if (ImGui::Selectable(getInterpolationName((Interpolation)i), is_selected))
+				interpolation = (Interpolation)i;
+
+			if (is_selected)
+				ImGui::SetItemDefaultFocus();
+		}
+
+		ImGui::EndCombo();
+	}
 }
 
-std::map<string, Animations> loadAnimationsFromDir(string dir_path, size_t children_bone_count)
+void animationPlaybackEditor(Simulation &simulation)
 {
-	std::map<string, Animations> animations;
-	for (const auto &entry : std::filesystem::directory_iterator(dir_path))
+	const PoseFrame *pose = simulation.latest();
+	bool paused = simulation.isPaused();
+	PlaybackMode mode = simulation.getPlaybackMode();
+	bool root_motion = simulation.isRootMotionEnabled();
+	float speed = simulation.getTimeScale();
+
+	if (ImGui::Checkbox("Pause", &paused))
 	{
-		if (entry.path().extension() != ".anim")
-			throw std::runtime_error("Invalid file type");
+		recordEvent(ReplayEvent(PauseEvent, paused));
+		simulation.setPaused(paused);
+	}
 
-		auto path = entry.path();
-		path = path.replace_extension("");
-		Animations a = loadAnimations(path, children_bone_count);
+	ImGui::SameLine();
+	ImGui::BeginDisabled(!paused);
+	if (ImGui::Button("Step"))
+	{
+		recordEvent(ReplayEvent(StepEvent));
+		simulation.step();
+	}
+	ImGui::EndDisabled();
 
-		if (!a.empty())
+	ImGui::SameLine();
+	if (ImGui::Checkbox("Root motion", &root_motion))
+	{
+		recordEvent(ReplayEvent(RootMotionEvent, root_motion));
+		simulation.setRootMotionEnabled(root_motion);
+	}
+
+	if (ImGui::BeginCombo("Mode", getPlaybackModeName(mode)))
+	{
+		for (size_t i = 0; i < PlaybackModeCount; i++)
 		{
-			auto path = entry.path();
-			string name = path.stem();
-			animations[name] = a;
+			bool is_selected = mode == (PlaybackMode)i;
+
+			if (ImGui::Selectable(getPlaybackModeName((PlaybackMode)i), is_selected))
+			{
+				recordEvent(ReplayEvent(PlaybackModeEvent, i));
+				simulation.setPlaybackMode((PlaybackMode)i);
+			}
+
+			if (is_selected)
+				ImGui::SetItemDefaultFocus();
 		}
+
+		ImGui::EndCombo();
+	}
+
+	if (ImGui::SliderFloat("Speed", &speed, 0.0f, 4.0f))
+	{
+		recordEvent(ReplayEvent(TimeScaleEvent, 0, {speed}));
+		simulation.setTimeScale(speed);
+	}
+
+	if (pose == nullptr || !pose->playing)
+		return;
+
+	float time = pose->time;
+
+	if (ImGui::SliderFloat("Seek", &time, 0.0f, pose->duration))
+	{
+		recordEvent(ReplayEvent(SeekEvent, 0, {time}));
+		simulation.seek(time);
 	}
 
-	return animations;
+	if (ImGui::Button("Stop"))
+	{
+		recordEvent(ReplayEvent(StopEvent));
+		simulation.stopAnimation();
+	}
 }
 
-Animations loadAnimations(const string name, size_t children_bone_count)
+// Clips blended over whatever every instance plays, additive ones on top of it.
+// A layer masked to some bones only drives them and everything below them.
+void layerEditor(Simulation &simulation)
 {
-	std::ifstream file(name + ".anim");
+	struct Layer
+	{
+		string name;
+		float weight;
+		bool additive;
+	};
+	static std::vector<Layer> layers;
+	static string layer_name;
+	static float weight = 1.0f;
+	static bool additive = false;
+	static std::vector<string> mask;
+	const Skeleton &skeleton = simulation.getSkeleton();
+	string mask_preview;
+
+	ImGui::Text("Layers");
+
+	if (ImGui::BeginCombo("Clip##layer", layer_name.c_str()))
+	{
+		for (auto &anim : name_to_animations)
+		{
+			bool is_selected = layer_name == anim.first;
 
-	if (!file.is_open())
+			if (anim.second.size() > 1 && ImGui::Selectable(anim.first.c_str(), is_selected))
+				layer_name = anim.first;
+
+			if (is_selected)
+				ImGui::SetItemDefaultFocus();
+		}
+
+		ImGui::EndCombo();
+	}
+
+	for (const string &bone : mask)
+		mask_preview += (mask_preview.empty() ? "" : ", ") + bone;
+
+	if (ImGui::BeginCombo("Mask##layer", mask.empty() ? "whole body" : mask_preview.c_str()))
 	{
-		std::cerr << "Animation " << name << " not found" << std::endl;
-		return Animations();
+		for (const string &bone : skeleton.names)
+		{
+			auto it = std::find(mask.begin(), mask.end(), bone);
+
+			if (ImGui::Selectable(bone.c_str(), it != mask.end(), ImGuiSelectableFlags_DontClosePopups))
+			{
+				if (it == mask.end())
+					mask.push_back(bone);
+				else
+					mask.erase(it);
+			}
+		}
+
+		ImGui::EndCombo();
 	}
 
-	std::stringstream buffer;
+	ImGui::SliderFloat("Weight##new_layer", &weight, 0.0f, 1.0f);
+	ImGui::Checkbox("Additive", &additive);
 
-	buffer << file.rdbuf();
+	ImGui::BeginDisabled(name_to_animations.count(layer_name) == 0);
+	if (ImGui::Button("Add layer"))
+	{
+		std::vector<float> values = {weight, (float)additive};
 
-	Animations animation;
-	std::vector<string> frames = split_set(buffer.str(), "~");
+		for (const string &bone : mask)
+			values.push_back(std::find(skeleton.names.begin(), skeleton.names.end(), bone) - skeleton.names.begin());
+		recordEvent(ReplayEvent(AddLayerEvent, interpolation, values, layer_name));
+		simulation.addLayer(std::make_shared<const Animations>(name_to_animations[layer_name]), weight, additive, interpolation, mask);
+		layers.push_back({layer_name + (mask.empty() ? "" : " (" + mask_preview + ")"), weight, additive});
+	}
+	ImGui::EndDisabled();
+
+	ImGui::SameLine();
+	if (ImGui::Button("Clear##layers"))
+	{
+		recordEvent(ReplayEvent(ClearLayersEvent));
+		simulation.clearLayers();
+		layers.clear();
+	}
 
-	for (string frame : frames)
+	for (size_t i = 0; i < layers.size(); i++)
 	{
-		float time;
+		string label = std::to_string(i) + ": " + layers[i].name + (layers[i].additive ? " (additive)" : "");
 
-		try
+		if (ImGui::SliderFloat(label.c_str(), &layers[i].weight, 0.0f, 1.0f))
 		{
-			time = std::stof(frame.substr(0, frame.find_first_of("\n")));
-			frame.erase(0, frame.find_first_of("\n") + 1);
+			recordEvent(ReplayEvent(LayerWeightEvent, i, {layers[i].weight}));
+			simulation.setLayerWeight(i, layers[i].weight);
 		}
-		catch (std::exception &e)
+	}
+}
+
+// Parameters are set on every instance at once
+void stateMachineEditor(Simulation &simulation)
+{
+	static char path[100] = DEFAULT_STATE_MACHINE;
+	static std::shared_ptr<const StateMachine> machine;
+	static std::vector<float> parameters;
+	const PoseFrame *frame = simulation.latest();
+
+	ImGui::Text("State Machine");
+
+	ImGui::InputText("File##states", path, 100);
+
+	if (ImGui::Button("Load##states"))
+	{
+		std::shared_ptr<const StateMachine> loaded = loadStateMachine(path, name_to_animations, interpolation);
+
+		if (loaded != nullptr)
 		{
-			std::cerr << "Error loading animation time of: " << name << std::endl;
-			std::cerr << e.what() << std::endl;
-			return Animations();
+			machine = loaded;
+			parameters = machine->defaults;
+			recordEvent(ReplayEvent(StateMachineEvent, interpolation, {}, machine->source));
+			simulation.setStateMachine(machine);
 		}
+	}
 
-		try
-		{
-			std::vector<string> string_animations = split_set(frame, "\n");
+	ImGui::SameLine();
+	if (ImGui::Button("Stop##states"))
+	{
+		recordEvent(ReplayEvent(StateMachineEvent, interpolation));
+		simulation.setStateMachine(nullptr);
+	}
 
-			animation[time] = parseAnimations(string_animations);
-		}
-		catch (std::exception &e)
+	if (machine == nullptr || frame == nullptr || frame->state >= machine->states.size())
+		return;
+
+	ImGui::Text("State: %s", machine->state_names[frame->state].c_str());
+
+	for (size_t i = 0; i < parameters.size(); i++)
+		if (ImGui::InputFloat(machine->parameter_names[i].c_str(), &parameters[i], 0.1f, 1.0f, "%.2f"))
 		{
-			std::cerr << "Error loading animation transforms of: " << name << std::endl;
-			std::cerr << e.what() << std::endl;
-			return Animations();
+			recordEvent(ReplayEvent(ParameterEvent, i, {parameters[i]}));
+			simulation.setParameter(i, parameters[i]);
 		}
+}
+
+void poseCacheEditor(Simulation &simulation)
+{
+	bool enabled = pose_cache.isEnabled();
+	float rate = pose_cache.getRate();
+
+	ImGui::Text("Pose Cache");
+
+	if (ImGui::Checkbox("Play baked poses", &enabled))
+	{
+		recordEvent(ReplayEvent(PoseCacheEvent, enabled, {rate}));
+		pose_cache.setEnabled(enabled);
 	}
 
-	file.close();
+	if (ImGui::InputFloat("Rate (Hz)", &rate, 10.0f, 30.0f, "%.0f"))
+	{
+		recordEvent(ReplayEvent(PoseCacheEvent, enabled, {rate}));
+		pose_cache.setRate(rate);
+	}
+
+	if (ImGui::Button("Bake all"))
+	{
+		recordEvent(ReplayEvent(BakePosesEvent));
+		pose_cache.bake(simulation.getSkeleton(), name_to_animations);
+	}
+
+	ImGui::SameLine();
+	if (ImGui::Button("Clear"))
+	{
+		recordEvent(ReplayEvent(ClearPosesEvent));
+		pose_cache.clear();
+	}
+
+	ImGui::Text("%zu clip(s), %.1f KiB", pose_cache.getClips().size(), pose_cache.bytes() / 1024.0f);
+
+	for (const auto &[name, clip] : pose_cache.getClips())
+		ImGui::BulletText("%s: %zu frames at %.0f Hz, %.1f KiB", name.c_str(), clip->frame_count, clip->rate, clip->bytes() / 1024.0f);
+}
+
+void compressionEditor()
+{
+	bool enabled = clip_compressor.isEnabled();
+	float tolerance = clip_compressor.getTolerance();
+
+	ImGui::Text("Compression");
+
+	if (ImGui::Checkbox("Play compressed clips", &enabled))
+	{
+		recordEvent(ReplayEvent(CompressionEvent, enabled, {tolerance}));
+		clip_compressor.setEnabled(enabled);
+	}
+
+	if (ImGui::InputFloat("Tolerance", &tolerance, 0.0005f, 0.005f, "%.4f"))
+	{
+		recordEvent(ReplayEvent(CompressionEvent, enabled, {tolerance}));
+		clip_compressor.setTolerance(tolerance);
+	}
+
+	if (ImGui::Button("Compress all"))
+	{
+		recordEvent(ReplayEvent(CompressClipsEvent));
+		clip_compressor.compress(name_to_animations);
+	}
 
-	if (!are_animations_valid(animation, children_bone_count))
+	ImGui::SameLine();
+	if (ImGui::Button("Clear##compression"))
 	{
-		std::cerr << "Animation " << name << " is invalid" << std::endl;
-		return Animations();
+		recordEvent(ReplayEvent(ClearCompressedEvent));
+		clip_compressor.clear();
 	}
 
-	std::cout << "Animation " << name << " loaded" << std::endl;
+	ImGui::Text("%zu clip(s), %.1f KiB", clip_compressor.getClips().size(), clip_compressor.bytes() / 1024.0f);
 
-	return animation;
+	for (const auto &[name, clip] : clip_compressor.getClips())
+		ImGui::BulletText("%s: %zu/%zu keys, %zu/%zu channels, %.1f/%.1f KiB, max error %.5f", name.c_str(), clip->times.size(),
+						  clip->source_keys, clip->animated.size(), clip->base.size(), clip->bytes() / 1024.0f,
+						  clip->source_bytes / 1024.0f, clip->max_error);
 }
 
-std::vector<Animation> parseAnimations(std::vector<string> string_animations)
+void cullingEditor(Simulation &simulation)
 {
-	std::vector<Animation> animations;
+	bool culling = simulation.isCulling();
+	bool lod = simulation.isLodEnabled();
+	const PoseFrame *frame = simulation.latest();
 
-	for (string transform : string_animations)
+	ImGui::Text("Culling");
+
+	if (ImGui::Checkbox("Frustum culling", &culling))
+	{
+		recordEvent(ReplayEvent(CullingEvent, culling));
+		simulation.setCulling(culling);
+	}
+
+	if (ImGui::Checkbox("Reduce distant update rate", &lod))
 	{
-		Animation a;
-		std::stringstream ss(transform);
-		ss >> a;
-		animations.push_back(a);
+		recordEvent(ReplayEvent(LodEvent, lod));
+		simulation.setLodEnabled(lod);
 	}
 
-	return animations;
+	if (frame == nullptr)
+		return;
+
+	ImGui::Text("Visible: %zu, culled: %zu", frame->instance_count, frame->culled);
+
+	for (size_t level = 0; level < LOD_LEVELS; level++)
+		ImGui::BulletText("Every %zu frame(s): %zu", (size_t)1 << level, frame->lod_instances[level]);
 }
 
-std::vector<string> split_set(string s, string delimiter)
+void footIkEditor(Simulation &simulation)
 {
-	std::vector<string> ret;
-	size_t pos_start = 0, pos_end = 0;
-	string token;
+	bool planting = simulation.isPlantingFeet();
+	IkSolver solver = simulation.getFootSolver();
 
-	while ((pos_start = s.find_first_not_of(delimiter, pos_end)) != string::npos)
+	ImGui::Text("Inverse Kinematics");
+
+	if (ImGui::Checkbox("Plant feet", &planting))
 	{
-		pos_start = s.find_first_not_of(delimiter, pos_end);
-		pos_end = s.find_first_of(delimiter, pos_start);
-		ret.push_back(s.substr(pos_start, pos_end - pos_start));
+		recordEvent(ReplayEvent(PlantFeetEvent, planting));
+		simulation.setPlantingFeet(planting);
+	}
+
+	if (ImGui::BeginCombo("Solver##ik", getIkSolverName(solver)))
+	{
+		for (size_t i = 0; i < IkSolverCount; i++)
+		{
+			bool is_selected = solver == (IkSolver)i;
+
+			if (ImGui::Selectable(getIkSolverName((IkSolver)i), is_selected))
+			{
+				recordEvent(ReplayEvent(FootSolverEvent, i));
+				simulation.setFootSolver((IkSolver)i);
+			}
+
+			if (is_selected)
+				ImGui::SetItemDefaultFocus();
+		}
+
+		ImGui::EndCombo();
 	}
-	return ret;
 }
 
-void runAnimations(Bone *root, Animations &a, std::chrono::_V2::system_clock::time_point start)
+void profilerEditor()
 {
-	float t = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000.0f;
-	auto before = a.lower_bound(t);
-	auto after = a.upper_bound(t);
+	bool enabled = profiler.isEnabled();
 
-	if (before != a.begin())
-		before--;
-	if (after == a.end())
-		after--;
-	t = (t - before->first) / (after->first - before->first);
+	// out of the way of the editors, which open in the top left corner
+	ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x - 440.0f, 20.0f), ImGuiCond_FirstUseEver);
+	ImGui::Begin("Profiler", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
 
-	std::vector<Animation> animations;
+	if (ImGui::Checkbox("Profile frames", &enabled))
+		profiler.setEnabled(enabled);
 
-	for (size_t i = 0; i < before->second.size(); i++)
+	if (!enabled || profiler.getFrameCount() == 0)
 	{
-		Animation animation;
+		ImGui::End();
+		return;
+	}
+
+	std::vector<float> frame_times = profiler.getFrameTimes();
+	float frame_time = profiler.getAverageFrameTime();
+	char overlay[64];
+
+	snprintf(overlay, sizeof(overlay), "%.2f ms (%.0f fps)", frame_time, frame_time > 0.0f ? 1000.0f / frame_time : 0.0f);
+	ImGui::PlotLines("Frame (ms)", frame_times.data(), frame_times.size(), 0, overlay, 0.0f, FLT_MAX, ImVec2(220.0f, 60.0f));
 
-		if (std::isinf(t))
-			animation = before->second[i];
-		else
-			animation = linear_interpolation(before->second[i], after->second[i], t);
+	ImGui::Text("Average over %zu frame(s)", profiler.getFrameCount());
 
-		animations.push_back(animation);
+	for (size_t zone = 0; zone < ProfileZoneCount; zone++)
+	{
+		float average = profiler.getAverage((ProfileZone)zone);
+
+		ImGui::BulletText("%s: %.3f ms (%.0f%%), %.1f alloc(s)", getProfileZoneName((ProfileZone)zone), average,
+						  frame_time > 0.0f ? 100.0f * average / frame_time : 0.0f, profiler.getAverageAllocations((ProfileZone)zone));
 	}
 
-	root->applyAnimations(animations);
+	if (isTrackingAllocations())
+		ImGui::Text("Allocations: %.1f/frame, %.1f KiB, peak %.1f KiB live", profiler.getAverageFrameAllocations(),
+					profiler.getAverageFrameBytes() / 1024.0f, profiler.getPeakBytes() / 1024.0f);
+
+	if (profiler.getDropped() > 0)
+		ImGui::Text("%zu sample(s) dropped", profiler.getDropped());
+
+	ImGui::End();
 }
 
-bool are_animations_valid(Animations &a, size_t children_bone_count)
+// Shown while profiling, under the profiler
+void gpuTimingEditor(const GpuTimer &gpu_timer)
 {
-	if (a.size() < 2 || a.begin()->first != 0.0f)
+	if (!profiler.isEnabled())
+		return;
+
+	ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x - 440.0f, 400.0f), ImGuiCond_FirstUseEver);
+	ImGui::Begin("GPU Timing", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+	if (!gpu_timer.isSupported())
 	{
-		return false;
+		ImGui::Text("Timer queries are not supported");
+		ImGui::End();
+		return;
 	}
 
-	auto num_animation = a.begin()->second.size();
+	float total = 0.0f;
 
-	if (num_animation != children_bone_count + 1)
-		return false;
+	ImGui::Text("Average over %zu frame(s)", gpu_timer.getFrameCount());
 
-	for (auto &keyframe : a)
+	for (size_t pass = 0; pass < GpuPassCount; pass++)
 	{
-		for (auto &animation : keyframe.second)
-			if (!animation.isValid())
-				return false;
-		if (keyframe.second.size() != num_animation)
-			return false;
+		float average = gpu_timer.getAverage((GpuPass)pass);
+
+		ImGui::BulletText("%s: %.3f ms", getGpuPassName((GpuPass)pass), average);
+		total += average;
 	}
 
-	return true;
+	ImGui::Text("Total: %.3f ms", total);
+
+	if (gpu_timer.getDropped() > 0)
+		ImGui::Text("%zu frame(s) not ready in time", gpu_timer.getDropped());
+
+	ImGui::End();
+}
+
+// Replays are given the whole clip again after every edit
+void recordClip(const string &name)
+{
+	const Animations &clip = name_to_animations[name];
+
+	recordEvent(ReplayEvent(ClipEvent, clip.empty() ? 0 : clip.begin()->second.size(), flattenClip(clip), name));
+}
+
+void setTimeToLastKeyframe(float &time, const string &current_animation_name)
+{
+	if (!name_to_animations[current_animation_name].empty())
+		time = name_to_animations[current_animation_name].rbegin()->first;
+	else
+		time = 0.0f;
 }
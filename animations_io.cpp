@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include "Animation.hpp"
+#include "Profiler.hpp"
+
+using std::string;
+
+void saveAnimations(const string name, const Animations &animations)
+{
+	std::ofstream file(name + ".anim");
+
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open file " << name << std::endl;
+		return;
+	}
+
+	for (const auto &[time, animation] : animations)
+	{
+		file << time << "\n";
+		for (const auto &a : animation)
+			file << a << "\n";
+		file << "~";
+	}
+
+	file.close();
+
+	std::cout << "Animation " << name << " saved" << std::endl;
+}
+
+std::map<string, Animations> loadAnimationsFromDir(string dir_path, const std::vector<size_t> &children_bone_counts)
+{
+	std::map<string, Animations> animations;
+	for (const auto &entry : std::filesystem::directory_iterator(dir_path))
+	{
+		if (entry.path().extension() != ".anim")
+			throw std::runtime_error("Invalid file type");
+
+		auto path = entry.path();
+		path = path.replace_extension("");
+		Animations a = loadAnimations(path, children_bone_counts);
+
+		if (!a.empty())
+		{
+			auto path = entry.path();
+			string name = path.stem();
+			animations[name] = a;
+		}
+	}
+
+	return animations;
+}
+
+Animations loadAnimations(const string name, const std::vector<size_t> &children_bone_counts)
+{
+	PROFILE_SCOPE(LoadZone);
+
+	std::ifstream file(name + ".anim");
+
+	if (!file.is_open())
+	{
+		std::cerr << "Animation " << name << " not found" << std::endl;
+		return Animations();
+	}
+
+	std::stringstream buffer;
+
+	buffer << file.rdbuf();
+
+	Animations animation;
+	std::vector<string> frames = split_set(buffer.str(), "~");
+
+	for (string frame : frames)
+	{
+		float time;
+
+		try
+		{
+			time = std::stof(frame.substr(0, frame.find_first_of("\n")));
+			frame.erase(0, frame.find_first_of("\n") + 1);
+		}
+		catch (std::exception &e)
+		{
+			std::cerr << "Error loading animation time of: " << name << std::endl;
+			std::cerr << e.what() << std::endl;
+			return Animations();
+		}
+
+		try
+		{
+			std::vector<string> string_animations = split_set(frame, "\n");
+
+			animation[time] = parseAnimations(string_animations);
+		}
+		catch (std::exception &e)
+		{
+			std::cerr << "Error loading animation transforms of: " << name << std::endl;
+			std::cerr << e.what() << std::endl;
+			return Animations();
+		}
+	}
+
+	file.close();
+
+	if (!are_animations_valid(animation, children_bone_counts))
+	{
+		std::cerr << "Animation " << name << " is invalid" << std::endl;
+		return Animations();
+	}
+
+	std::cout << "Animation " << name << " loaded" << std::endl;
+
+	return animation;
+}
+
+std::vector<Animation> parseAnimations(std::vector<string> string_animations)
+{
+	std::vector<Animation> animations;
+
+	for (string transform : string_animations)
+	{
+		Animation a;
+		std::stringstream ss(transform);
+		ss >> a;
+		animations.push_back(a);
+	}
+
+	return animations;
+}
+
+std::vector<string> split_set(string s, string delimiter)
+{
+	std::vector<string> ret;
+	size_t pos_start = 0, pos_end = 0;
+	string token;
+
+	while ((pos_start = s.find_first_not_of(delimiter, pos_end)) != string::npos)
+	{
+		pos_start = s.find_first_not_of(delimiter, pos_end);
+		pos_end = s.find_first_of(delimiter, pos_start);
+		ret.push_back(s.substr(pos_start, pos_end - pos_start));
+	}
+	return ret;
+}
+
+// Any of the bone counts is accepted, one per rig the clips may be made for
+bool are_animations_valid(Animations &a, const std::vector<size_t> &children_bone_counts)
+{
+	if (a.size() < 2 || a.begin()->first != 0.0f)
+	{
+		return false;
+	}
+
+	auto num_animation = a.begin()->second.size();
+
+	if (std::find(children_bone_counts.begin(), children_bone_counts.end(), num_animation - 1) == children_bone_counts.end())
+		return false;
+
+	for (auto &keyframe : a)
+	{
+		for (auto &animation : keyframe.second)
+			if (!animation.isValid())
+				return false;
+		if (keyframe.second.size() != num_animation)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,232 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "ClipCompressor.hpp"
+#include "PoseCache.hpp"
+#include "settings.hpp"
+
+// Headless pose baker: evaluates the world matrix of every bone of every clip at a fixed
+// sample rate and writes them out, without a window or an OpenGL context.
+// With --compress, clips go through ClipCompressor first and an error report is printed,
+// so the output is what the application plays with the same tolerance.
+//
+// csv: one line per bone per sample: clip,frame,time,bone,m00,m01,...,m33
+// bin: "HGLB", u32 version, u32 bone count, u32 clip count,
+//      bone count x (u32 length, name),
+//      clip count x (u32 length, name, f32 sample rate, u32 frame count,
+//                    frame count x bone count x 16 f32 row-major matrices)
+
+typedef enum BakeFormat {
+    Csv = 0,
+    Binary
+} BakeFormat;
+
+typedef std::map<std::string, std::shared_ptr<const BakedClip>> BakedClips;
+
+static void usage(const char *name)
+{
+    std::cerr << "Usage: " << name << " [human|alien (default: human)] [--rate hz (default: " << BAKE_SAMPLE_RATE << ")]"
+              << " [--format csv|bin (default: csv)] [--output path (default: " << BAKE_OUTPUT << ".<format>)]"
+              << " [--compress tolerance]"
+              << " [clip.anim|directory ... (default: " << DEFAULT_ANIMATIONS_DIRECTORY << ")]" << std::endl;
+}
+
+static void writeCsv(std::ofstream &file, const Skeleton &skeleton, const BakedClips &clips)
+{
+    file << "clip,frame,time,bone";
+    for (int i = 0; i < 16; i++)
+        file << ",m" << i / 4 << i % 4;
+    file << "\n";
+
+    for (const auto &[name, clip] : clips)
+    {
+        for (size_t frame = 0; frame < clip->frame_count; frame++)
+        {
+            for (size_t bone = 0; bone < skeleton.size(); bone++)
+            {
+                const float *m = &clip->transforms[(frame * skeleton.size() + bone) * 16];
+
+                file << name << "," << frame << "," << std::fmin(frame / clip->rate, clip->duration) << "," << skeleton.names[bone];
+                for (int i = 0; i < 16; i++)
+                    file << "," << m[i];
+                file << "\n";
+            }
+        }
+    }
+}
+
+static void writeString(std::ofstream &file, const std::string &s)
+{
+    uint32_t length = s.size();
+
+    file.write((const char *)&length, sizeof(length));
+    file.write(s.data(), length);
+}
+
+static void writeBinary(std::ofstream &file, const Skeleton &skeleton, const BakedClips &clips)
+{
+    uint32_t header[] = {1, (uint32_t)skeleton.size(), (uint32_t)clips.size()};
+
+    file.write("HGLB", 4);
+    file.write((const char *)header, sizeof(header));
+
+    for (const std::string &name : skeleton.names)
+        writeString(file, name);
+
+    for (const auto &[name, clip] : clips)
+    {
+        uint32_t frame_count = clip->frame_count;
+
+        writeString(file, name);
+        file.write((const char *)&clip->rate, sizeof(clip->rate));
+        file.write((const char *)&frame_count, sizeof(frame_count));
+        file.write((const char *)clip->transforms.data(), clip->transforms.size() * sizeof(float));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ModelType model_type = Human;
+    float rate = BAKE_SAMPLE_RATE;
+    float tolerance = -1.0f;
+    BakeFormat format = Csv;
+    std::string output;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "-h")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else if (arg == "human" || arg == "alien")
+            model_type = arg == "human" ? Human : Alien;
+        else if (arg == "--rate" && has_value)
+        {
+            try
+            {
+                rate = std::stof(argv[++i]);
+            }
+            catch (std::exception &e)
+            {
+                rate = 0.0f;
+            }
+
+            if (!(rate > 0.0f))
+            {
+                std::cerr << "Invalid sample rate: " << argv[i] << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--compress" && has_value)
+        {
+            try
+            {
+                tolerance = std::stof(argv[++i]);
+            }
+            catch (std::exception &e)
+            {
+                tolerance = -1.0f;
+            }
+
+            if (!(tolerance >= 0.0f))
+            {
+                std::cerr << "Invalid tolerance: " << argv[i] << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--format" && has_value)
+        {
+            std::string value = argv[++i];
+
+            if (value != "csv" && value != "bin")
+            {
+                std::cerr << "Invalid format: " << value << std::endl;
+                return -1;
+            }
+            format = value == "csv" ? Csv : Binary;
+        }
+        else if (arg == "--output" && has_value)
+            output = argv[++i];
+        else if (arg[0] == '-')
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        else
+            inputs.push_back(arg);
+    }
+
+    if (inputs.empty())
+        inputs.push_back(DEFAULT_ANIMATIONS_DIRECTORY);
+    if (output.empty())
+        output = std::string(BAKE_OUTPUT) + (format == Csv ? ".csv" : ".bin");
+
+    Skeleton skeleton = createSkeleton(model_type);
+    std::map<std::string, Animations> clips;
+
+    for (const std::string &input : inputs)
+    {
+        std::filesystem::path path(input);
+
+        if (std::filesystem::is_directory(path))
+        {
+            std::map<std::string, Animations> loaded = loadAnimationsFromDir(input, {skeleton.size() - 1});
+            clips.insert(loaded.begin(), loaded.end());
+        }
+        else
+        {
+            Animations clip = loadAnimations(path.replace_extension(""), {skeleton.size() - 1});
+
+            if (!clip.empty())
+                clips[path.stem()] = clip;
+        }
+    }
+
+    if (clips.empty())
+    {
+        std::cerr << "No valid animation to bake" << std::endl;
+        return -1;
+    }
+
+    if (tolerance >= 0.0f)
+    {
+        for (auto &[name, clip] : clips)
+        {
+            std::shared_ptr<const CompressedClip> compressed = compressClip(clip, tolerance);
+
+            std::cout << name << ": " << compressed->times.size() << "/" << compressed->source_keys << " keys, "
+                      << compressed->animated.size() << "/" << compressed->base.size() << " channels, "
+                      << compressed->bytes() << "/" << compressed->source_bytes << " bytes, max error " << compressed->max_error << std::endl;
+            clip = compressed->decompress();
+        }
+    }
+
+    BakedClips baked;
+
+    for (const auto &[name, clip] : clips)
+        baked[name] = bakeClip(skeleton, clip, rate);
+
+    std::ofstream file(output, format == Csv ? std::ios::out : std::ios::out | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open file " << output << std::endl;
+        return -1;
+    }
+
+    if (format == Csv)
+        writeCsv(file, skeleton, baked);
+    else
+        writeBinary(file, skeleton, baked);
+
+    file.close();
+
+    std::cout << "Baked " << baked.size() << " animation(s) into " << output << std::endl;
+
+    return 0;
+}
@@ -1,5 +1,6 @@
 #ifndef HUMANGL_HPP
 #define HUMANGL_HPP
+#include <algorithm>
 #include <vector>
 #include <GL/glew.h>
 #include <chrono>
@@ -12,24 +13,32 @@
 #include "ft_mat.hpp"
 #include "settings.hpp"
 #include "Animation.hpp"
+#include "Skeleton.hpp"
+#include "Simulation.hpp"
+#include "PoseCache.hpp"
+#include "ClipCompressor.hpp"
+#include "Replay.hpp"
+#include "Profiler.hpp"
+#include "GpuTimer.hpp"
 #include "imgui.h"
 
 typedef ft::vector<float> vec;
 typedef ft::matrix<float> mat;
-typedef std::map<float, std::vector<Animation>> Animations;
 
 using std::string;
 using namespace std::chrono::_V2;
 
 extern std::map<string, Animations> name_to_animations;
-extern Animations *current_animation;
-extern system_clock::time_point start_time;
-extern system_clock::time_point end_time;
+extern PoseCache pose_cache;
+extern ClipCompressor clip_compressor;
+extern Interpolation interpolation;
 
-typedef enum ModelType {
-    Human = 0,
-    Alien
-} ModelType;
+// Kept in the replay being recorded, if any
+void recordEvent(const ReplayEvent &event);
+
+// Clips of either model, retargeted onto the one being edited
+std::map<string, Animations> loadModelAnimations();
+Animations loadModelAnimation(const string &path);
 
 class Bone
 {
@@ -51,14 +60,9 @@ protected:
     vec default_dims;
     vec default_color;
 
-private:
-    uint VAO, VBO, EBO;
-
 public:
     Bone(string name, Bone *parent, vec dims, vec jointPos, vec jointRot, vec color);
 
-    ~Bone();
-
     vec &getColor();
     void setColor(vec color);
 
@@ -77,35 +81,40 @@ public:
     std::vector<Bone *> getChildren();
     size_t getChildrenCount();
 
-    void render(GLuint shaderProgram);
-    void renderModel(GLuint shaderProgram);
-
     void clear();
 
     std::vector<mat> getTransforms();
     std::vector<Animation> getAnimations();
     void applyAnimations(std::vector<Animation> animations);
+    void setAnimations(const std::vector<Animation> &animations);
     void setTransforms(std::vector<mat> transforms);
     void resetTransforms();
     void applyTransforms(mat parentTransform);
+
+private:
+    size_t setAnimations(const std::vector<Animation> &animations, size_t index);
 };
 
 Bone *createModel(ModelType model_type);
 void boneEditor(Bone *bone);
 
-void animationEditor(Bone *root);
+void animationEditor(Bone *root, Simulation &simulation);
 void animationSelectionEditor(string &current_animation_name, float &time);
 void currentAnimationEditor(Bone *root, string &current_animation_name, float &time);
-void saveAnimations(const string name, const Animations &a);
 void animationCreationEditor(string &current_animation_name, float &time);
-void animationLoadEditor(Bone *root);
-void animationPlayEditor();
+void animationLoadEditor();
+void animationPlayEditor(Simulation &simulation);
+void interpolationEditor();
+void animationPlaybackEditor(Simulation &simulation);
+void layerEditor(Simulation &simulation);
+void stateMachineEditor(Simulation &simulation);
+void poseCacheEditor(Simulation &simulation);
+void compressionEditor();
+void cullingEditor(Simulation &simulation);
+void footIkEditor(Simulation &simulation);
+void profilerEditor();
+void gpuTimingEditor(const GpuTimer &gpu_timer);
 void setTimeToLastKeyframe(float &time, const string &current_animation_name);
-std::map<string, Animations> loadAnimationsFromDir(string dir_path, size_t bone_count);
-Animations loadAnimations(const string name, size_t bone_count);
-std::vector<Animation> parseAnimations(std::vector<string> string_animations);
-std::vector<string> split_set(string s, string delimiter);
-void runAnimations(Bone *root, Animations &a, system_clock::time_point start);
-bool are_animations_valid(Animations &a, size_t bone_count);
+void recordClip(const string &name);
 
 #endif
\ No newline at end of file
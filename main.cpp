@@ -1,27 +1,37 @@
 #include <map>
+#include <sstream>
 #include "humanGL.hpp"
 #include "Camera.hpp"
 #include "GL_Prog.hpp"
+#include "Renderer.hpp"
+#include "FrameCapture.hpp"
+#include "PoseCompute.hpp"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
 using namespace std::chrono::_V2;
 
-bool keys[GLFW_KEY_LAST] = {false};
+bool keys[GLFW_KEY_LAST + 1] = {false};
 ModelType model_type = Human;
 vec background_color = {BACKGROUND_COLOR_R, BACKGROUND_COLOR_G, BACKGROUND_COLOR_B, BACKGROUND_COLOR_A};
 Bone *root;
 std::map<string, Animations> name_to_animations;
-Animations *current_animation;
-system_clock::time_point start_time = std::chrono::high_resolution_clock::time_point();
-system_clock::time_point end_time = start_time;
+PoseCache pose_cache;
+ClipCompressor clip_compressor;
+Interpolation interpolation = Linear;
+std::unique_ptr<ReplayRecorder> recorder;
+bool replaying = false;
 
-static void key_callback(GLFWwindow *window, int key, [[maybe_unused]] int scancode, int action, [[maybe_unused]] int mods)
+void recordEvent(const ReplayEvent &event)
 {
-    keys[key] = action != GLFW_RELEASE;
+    if (recorder != nullptr)
+        recorder->record(event);
+}
 
-    if (keys[KEY_EXIT])
-        glfwSetWindowShouldClose(window, GLFW_TRUE);
+// Everything a key does besides moving the camera, replayed as is
+static void pressKey(int key, bool pressed)
+{
+    keys[key] = pressed;
 
     if (keys[KEY_RECREATE_MODEL])
     {
@@ -30,11 +40,25 @@ static void key_callback(GLFWwindow *window, int key, [[maybe_unused]] int scanc
     }
 }
 
+static void key_callback(GLFWwindow *window, int key, [[maybe_unused]] int scancode, int action, [[maybe_unused]] int mods)
+{
+    // a replay presses the recorded keys itself and only listens for the exit key.
+    // Keys GLFW does not know come as GLFW_KEY_UNKNOWN.
+    if ((replaying && key != KEY_EXIT) || key < 0)
+        return;
+
+    recordEvent(ReplayEvent(action != GLFW_RELEASE ? KeyPressEvent : KeyReleaseEvent, key));
+    pressKey(key, action != GLFW_RELEASE);
+
+    if (keys[KEY_EXIT])
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+}
+
 static void mouse_callback([[maybe_unused]] GLFWwindow *window, [[maybe_unused]] double xpos, [[maybe_unused]] double ypos) {}
 
 ModelType getModelType(int argc, char **argv)
 {
-    if (argc < 2)
+    if (argc < 2 || argv[1][0] == '-')
     {
         return Human;
     }
@@ -55,82 +79,861 @@ ModelType getModelType(int argc, char **argv)
     }
 }
 
+const char *getOption(int argc, char **argv, const char *name)
+{
+    for (int i = 1; i < argc - 1; i++)
+        if (strcmp(argv[i], name) == 0)
+            return argv[i + 1];
+
+    return nullptr;
+}
+
+bool hasFlag(int argc, char **argv, const char *name)
+{
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], name) == 0)
+            return true;
+
+    return false;
+}
+
+double getNumberOption(int argc, char **argv, const char *name, double default_value)
+{
+    const char *value = getOption(argc, argv, name);
+
+    if (value == nullptr)
+        return default_value;
+
+    try
+    {
+        double number = std::stod(value);
+
+        if (number >= 0)
+            return number;
+    }
+    catch (std::exception &e)
+    {
+    }
+
+    std::cerr << "Invalid value for " << name << ": " << value << std::endl;
+
+    exit(-1);
+}
+
+size_t getCrowdSize(int argc, char **argv)
+{
+    return getNumberOption(argc, argv, "--crowd", CROWD_SIZE);
+}
+
+// The editable model first, then the other rig when the crowd is mixed
+std::vector<Skeleton> getRigs(int argc, char **argv)
+{
+    std::vector<Skeleton> rigs = {createSkeleton(model_type)};
+
+    if (hasFlag(argc, argv, "--mix"))
+        rigs.push_back(createSkeleton(model_type == Human ? Alien : Human));
+
+    return rigs;
+}
+
+// Clips made for the other model are retargeted onto this one by bone name
+Animations retargetToModel(const string &name, const Animations &clip)
+{
+    Skeleton model = createSkeleton(model_type);
+
+    if (clip.empty() || clip.begin()->second.size() == model.size())
+        return clip;
+
+    Skeleton other = createSkeleton(model_type == Human ? Alien : Human);
+
+    std::cout << "Animation " << name << " retargeted" << std::endl;
+
+    return retargetClip(clip, getRetargetMap(other, model), model.bind_pose);
+}
+
+// Bones below the root of this model, then of the other one
+std::vector<size_t> getModelBoneCounts()
+{
+    return {createSkeleton(model_type).size() - 1, createSkeleton(model_type == Human ? Alien : Human).size() - 1};
+}
+
+std::map<string, Animations> loadModelAnimations()
+{
+    std::map<string, Animations> animations = loadAnimationsFromDir(DEFAULT_ANIMATIONS_DIRECTORY, getModelBoneCounts());
+
+    for (auto &[name, clip] : animations)
+        clip = retargetToModel(name, clip);
+
+    return animations;
+}
+
+// Loaded from the editor, which names the file without its extension
+Animations loadModelAnimation(const string &path)
+{
+    return retargetToModel(path, loadAnimations(path, getModelBoneCounts()));
+}
+
+void bakeStartupPoseCache(const Skeleton &skeleton, int argc, char **argv)
+{
+    if (getOption(argc, argv, "--cache") == nullptr)
+        return;
+
+    pose_cache.setRate(getNumberOption(argc, argv, "--cache", POSE_CACHE_RATE));
+    pose_cache.setEnabled(true);
+    pose_cache.bake(skeleton, name_to_animations);
+
+    std::cout << "Baked " << pose_cache.getClips().size() << " animation(s), " << pose_cache.bytes() / 1024 << " KiB" << std::endl;
+}
+
+void compressStartupClips(int argc, char **argv)
+{
+    if (getOption(argc, argv, "--compress") == nullptr)
+        return;
+
+    float max_error = 0.0f;
+    size_t source_bytes = 0;
+
+    clip_compressor.setTolerance(getNumberOption(argc, argv, "--compress", CLIP_COMPRESSION_TOLERANCE));
+    clip_compressor.setEnabled(true);
+    clip_compressor.compress(name_to_animations);
+
+    for (const auto &[name, clip] : clip_compressor.getClips())
+    {
+        max_error = std::fmax(max_error, clip->max_error);
+        source_bytes += clip->source_bytes;
+    }
+
+    std::cout << "Compressed " << clip_compressor.getClips().size() << " animation(s), " << source_bytes / 1024 << " KiB to "
+              << clip_compressor.bytes() / 1024 << " KiB, max error " << max_error << std::endl;
+}
+
+Interpolation getInterpolation(int argc, char **argv)
+{
+    const char *name = getOption(argc, argv, "--interpolation");
+
+    if (name == nullptr)
+        return Linear;
+
+    for (size_t i = 0; i < InterpolationCount; i++)
+        if (strcmp(name, getInterpolationName((Interpolation)i)) == 0)
+            return (Interpolation)i;
+
+    std::cerr << "Invalid interpolation: " << name << std::endl;
+
+    exit(-1);
+}
+
+// --loop is short for --mode loop
+PlaybackMode getPlaybackMode(int argc, char **argv)
+{
+    const char *name = getOption(argc, argv, "--mode");
+
+    if (name == nullptr)
+        return hasFlag(argc, argv, "--loop") ? Loop : Once;
+
+    for (size_t i = 0; i < PlaybackModeCount; i++)
+        if (strcmp(name, getPlaybackModeName((PlaybackMode)i)) == 0)
+            return (PlaybackMode)i;
+
+    std::cerr << "Invalid playback mode: " << name << std::endl;
+
+    exit(-1);
+}
+
+void playStartupAnimation(Simulation &simulation, int argc, char **argv)
+{
+    const char *name = getOption(argc, argv, "--play");
+
+    simulation.setPlaybackMode(getPlaybackMode(argc, argv));
+    simulation.setRootMotionEnabled(hasFlag(argc, argv, "--root-motion"));
+
+    if (name == nullptr)
+        return;
+
+    if (name_to_animations.count(name) == 0)
+    {
+        std::cerr << "Unknown animation: " << name << std::endl;
+
+        exit(-1);
+    }
+
+    simulation.play(std::make_shared<const Animations>(name_to_animations[name]), pose_cache.get(name), clip_compressor.get(name), interpolation);
+}
+
+void loadStartupStateMachine(Simulation &simulation, int argc, char **argv)
+{
+    const char *path = getOption(argc, argv, "--states");
+
+    if (path == nullptr)
+        return;
+
+    std::shared_ptr<const StateMachine> machine = loadStateMachine(path, name_to_animations, interpolation);
+
+    if (machine == nullptr)
+        exit(-1);
+
+    simulation.setStateMachine(machine);
+}
+
+void addStartupLayer(Simulation &simulation, int argc, char **argv)
+{
+    const char *name = getOption(argc, argv, "--layer");
+
+    if (name == nullptr)
+        return;
+
+    if (name_to_animations.count(name) == 0 || name_to_animations[name].size() < 2)
+    {
+        std::cerr << "Unknown animation: " << name << std::endl;
+
+        exit(-1);
+    }
+
+    const char *mask = getOption(argc, argv, "--mask");
+
+    simulation.addLayer(std::make_shared<const Animations>(name_to_animations[name]), 1.0f, hasFlag(argc, argv, "--additive"), interpolation,
+                        mask != nullptr ? split_set(mask, ",") : std::vector<string>());
+}
+
+void plantStartupFeet(Simulation &simulation, int argc, char **argv)
+{
+    const char *name = getOption(argc, argv, "--plant-feet");
+
+    if (name == nullptr)
+        return;
+
+    for (size_t i = 0; i < IkSolverCount; i++)
+    {
+        if (strcmp(name, getIkSolverName((IkSolver)i)) == 0)
+        {
+            simulation.setFootSolver((IkSolver)i);
+            simulation.setPlantingFeet(true);
+            return;
+        }
+    }
+
+    std::cerr << "Invalid solver: " << name << std::endl;
+
+    exit(-1);
+}
+
+std::shared_ptr<const Replay> loadStartupReplay(int argc, char **argv)
+{
+    const char *path = getOption(argc, argv, "--replay");
+
+    if (path == nullptr)
+        return nullptr;
+
+    std::shared_ptr<const Replay> replay = loadReplay(path);
+
+    if (replay == nullptr)
+        exit(-1);
+
+    return replay;
+}
+
+std::vector<float> getRestPoseValues()
+{
+    std::vector<Animation> pose = root->getAnimations();
+    std::vector<float> values(12 * pose.size());
+
+    flattenPose(pose, values.data());
+
+    return values;
+}
+
+std::vector<float> getCameraValues(const Camera &cam)
+{
+    std::vector<float> values;
+
+    for (const vec *v : {&cam.eye, &cam.center, &cam.up})
+        for (size_t c = 0; c < 3; c++)
+            values.push_back((*v)[c]);
+
+    return values;
+}
+
+// The file is recorded whole, replays compile it again against their own clips
+void setReplayStateMachine(const ReplayEvent &event, Simulation &simulation)
+{
+    if (event.name.empty())
+    {
+        simulation.setStateMachine(nullptr);
+        return;
+    }
+
+    std::istringstream text(event.name);
+    std::shared_ptr<const StateMachine> machine = loadStateMachine(text, "in replay", name_to_animations, (Interpolation)event.value);
+
+    if (machine != nullptr)
+        simulation.setStateMachine(machine);
+}
+
+// The mask is recorded as bone indices in the editable model
+void addReplayLayer(const ReplayEvent &event, Simulation &simulation)
+{
+    const std::vector<string> &names = simulation.getSkeleton().names;
+    std::vector<string> mask;
+
+    if (name_to_animations.count(event.name) == 0 || name_to_animations[event.name].empty())
+    {
+        std::cerr << "Replay: unknown animation " << event.name << std::endl;
+        return;
+    }
+
+    for (size_t i = 2; i < event.values.size(); i++)
+        if ((size_t)event.values[i] < names.size())
+            mask.push_back(names[(size_t)event.values[i]]);
+
+    simulation.addLayer(std::make_shared<const Animations>(name_to_animations[event.name]), event.values[0], event.values[1] != 0.0f,
+                        (Interpolation)event.value, mask);
+}
+
+// Applies the inputs recorded on one frame, the events from next on
+void replayFrame(const Replay &replay, size_t &next, size_t frame, Simulation &simulation, Camera &cam)
+{
+    for (; next < replay.events.size() && replay.events[next].frame == frame; next++)
+    {
+        const ReplayEvent &event = replay.events[next];
+        const std::vector<float> &values = event.values;
+
+        switch (event.type)
+        {
+        case KeyPressEvent:
+        case KeyReleaseEvent:
+            pressKey(event.value, event.type == KeyPressEvent);
+            break;
+        case CameraEvent:
+            cam.eye = vec({values[0], values[1], values[2]});
+            cam.center = vec({values[3], values[4], values[5]});
+            cam.up = vec({values[6], values[7], values[8]});
+            break;
+        case RestPoseEvent:
+            if (values.size() != 12 * simulation.getSkeleton().size())
+            {
+                std::cerr << "Replay: rest pose of " << values.size() / 12 << " bone(s) does not fit the model" << std::endl;
+                break;
+            }
+            root->setAnimations(unflattenPose(values.data(), values.size() / 12));
+            break;
+        case PlayEvent:
+            if (name_to_animations.count(event.name) == 0 || name_to_animations[event.name].empty())
+            {
+                std::cerr << "Replay: unknown animation " << event.name << std::endl;
+                break;
+            }
+            simulation.play(std::make_shared<const Animations>(name_to_animations[event.name]), pose_cache.get(event.name),
+                            clip_compressor.get(event.name), (Interpolation)event.value);
+            break;
+        case StopEvent:
+            simulation.stopAnimation();
+            break;
+        case SeekEvent:
+            simulation.seek(values[0]);
+            break;
+        case PauseEvent:
+            simulation.setPaused(event.value);
+            break;
+        case StepEvent:
+            simulation.step();
+            break;
+        case TimeScaleEvent:
+            simulation.setTimeScale(values[0]);
+            break;
+        case PlaybackModeEvent:
+            simulation.setPlaybackMode((PlaybackMode)event.value);
+            break;
+        case RootMotionEvent:
+            simulation.setRootMotionEnabled(event.value);
+            break;
+        case ClipEvent:
+            if (event.value != 0 && (size_t)event.value != simulation.getSkeleton().size())
+            {
+                std::cerr << "Replay: animation " << event.name << " does not fit the model" << std::endl;
+                break;
+            }
+            name_to_animations[event.name] = unflattenClip(values, event.value);
+            pose_cache.invalidate(event.name);
+            clip_compressor.invalidate(event.name);
+            break;
+        case DeleteClipEvent:
+            name_to_animations.erase(event.name);
+            pose_cache.invalidate(event.name);
+            clip_compressor.invalidate(event.name);
+            break;
+        case CrossfadeEvent:
+            simulation.setCrossfade(values[0]);
+            break;
+        case AddLayerEvent:
+            addReplayLayer(event, simulation);
+            break;
+        case LayerWeightEvent:
+            simulation.setLayerWeight(event.value, values[0]);
+            break;
+        case ClearLayersEvent:
+            simulation.clearLayers();
+            break;
+        case StateMachineEvent:
+            setReplayStateMachine(event, simulation);
+            break;
+        case ParameterEvent:
+            simulation.setParameter(event.value, values[0]);
+            break;
+        case PlantFeetEvent:
+            simulation.setPlantingFeet(event.value);
+            break;
+        case FootSolverEvent:
+            simulation.setFootSolver((IkSolver)event.value);
+            break;
+        case CullingEvent:
+            simulation.setCulling(event.value);
+            break;
+        case LodEvent:
+            simulation.setLodEnabled(event.value);
+            break;
+        case PoseCacheEvent:
+            pose_cache.setEnabled(event.value);
+            pose_cache.setRate(values[0]);
+            break;
+        case BakePosesEvent:
+            pose_cache.bake(simulation.getSkeleton(), name_to_animations);
+            break;
+        case ClearPosesEvent:
+            pose_cache.clear();
+            break;
+        case CompressionEvent:
+            clip_compressor.setEnabled(event.value);
+            clip_compressor.setTolerance(values[0]);
+            break;
+        case CompressClipsEvent:
+            clip_compressor.compress(name_to_animations);
+            break;
+        case ClearCompressedEvent:
+            clip_compressor.clear();
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// Wall clock time of a whole replay, the figure to compare between builds
+void printReplayTime(size_t frames, std::chrono::steady_clock::time_point start)
+{
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Replayed " << frames << " frame(s) in " << seconds << " s, " << seconds * 1000.0 / std::max(frames, (size_t)1)
+              << " ms per frame" << std::endl;
+}
+
+// --profile turns the profiler on from the start, --trace also writes what it records to a file
+void startProfiler(int argc, char **argv)
+{
+    const char *trace_path = getOption(argc, argv, "--trace");
+
+    profiler.setThreadName("render");
+    profiler.setEnabled(hasFlag(argc, argv, "--profile"));
+
+    if (trace_path != nullptr && !profiler.startTrace(trace_path))
+        exit(-1);
+}
+
+// Per-zone and per-pass averages over the last frames of a run
+void printProfile(const GpuTimer &gpu_timer)
+{
+    std::cout << "Profiled " << profiler.getFrameCount() << " frame(s), " << profiler.getAverageFrameTime() << " ms per frame:" << std::endl;
+
+    for (size_t zone = 0; zone < ProfileZoneCount; zone++)
+        std::cout << "    " << getProfileZoneName((ProfileZone)zone) << ": " << profiler.getAverage((ProfileZone)zone) << " ms, "
+                  << profiler.getAverageAllocations((ProfileZone)zone) << " allocation(s)" << std::endl;
+
+    if (isTrackingAllocations())
+        std::cout << "Allocations: " << profiler.getAverageFrameAllocations() << " per frame, " << profiler.getAverageFrameBytes()
+                  << " bytes, peak " << profiler.getPeakBytes() << " bytes live" << std::endl;
+
+    if (!gpu_timer.isSupported())
+        return;
+
+    std::cout << "GPU time over " << gpu_timer.getFrameCount() << " frame(s), " << gpu_timer.getDropped() << " dropped:" << std::endl;
+
+    for (size_t pass = 0; pass < GpuPassCount; pass++)
+        std::cout << "    " << getGpuPassName((GpuPass)pass) << ": " << gpu_timer.getAverage((GpuPass)pass) << " ms" << std::endl;
+}
+
+// Compute shader pose evaluation when asked for and available, CPU evaluation otherwise.
+// The shader only samples clips linearly, bone for bone: frames that need more than that
+// are still evaluated on the CPU, see Simulation::isGpuEvaluable.
+std::unique_ptr<PoseCompute> createPoseCompute(GL_Prog &prog, Simulation &simulation, const Renderer &renderer, int argc, char **argv)
+{
+    if (!hasFlag(argc, argv, "--gpu"))
+        return nullptr;
+
+    if (!renderer.isBatched() || !PoseCompute::isSupported(simulation.getRigs()))
+    {
+        std::cerr << "Compute shaders are not supported, evaluating poses on the CPU" << std::endl;
+        return nullptr;
+    }
+
+    simulation.setGpuEvaluated(true);
+    std::cout << "Evaluating poses on the GPU, except while crossfading, layering, planting feet, retargeting"
+              << " or interpolating other than linearly" << std::endl;
+
+    return std::make_unique<PoseCompute>(prog.createComputeProgram("shaders/pose_cs.glsl"), simulation.getRigs());
+}
+
+mat getProjection(float aspect)
+{
+    return perspective(M_PI / 4, aspect, 0.1f, 100.0f);
+}
+
+void renderScene(GLuint shaderProgram, const Camera &cam, Renderer &renderer, const PoseFrame *pose, float aspect)
+{
+    glEnable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glUseProgram(shaderProgram);
+    glClearColor(background_color[0], background_color[1], background_color[2], background_color[3]);
+
+    mat view = cam.getViewMatrix();
+    mat projection = getProjection(aspect);
+
+    vec buff_view(view.begin(), view.end());
+    vec buff_projection(projection.begin(), projection.end());
+
+    GLint viewLoc = glGetUniformLocation(shaderProgram, "uView");
+    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &(buff_view[0]));
+
+    GLint projectionLoc = glGetUniformLocation(shaderProgram, "uProjection");
+    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, &(buff_projection[0]));
+
+    glUniform3f(glGetUniformLocation(shaderProgram, "Color"), 1.0f, 0.0f, 0.0f);
+
+    if (pose != nullptr)
+        renderer.render(shaderProgram, *pose);
+}
+
+// Renders a fixed number of frames at a fixed frame rate into an image sequence, without a window
+int runOffscreen(int argc, char **argv, const char *directory)
+{
+    int width = WINDOW_WIDTH;
+    int height = WINDOW_HEIGHT;
+    const char *size = getOption(argc, argv, "--size");
+    const char *format = getOption(argc, argv, "--format");
+    double fps = getNumberOption(argc, argv, "--fps", CAPTURE_FPS);
+    size_t frames = getNumberOption(argc, argv, "--frames", 0);
+    std::shared_ptr<const Replay> replay = loadStartupReplay(argc, argv);
+
+    if (size != nullptr && (sscanf(size, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0))
+    {
+        std::cerr << "Invalid size: " << size << std::endl;
+        return -1;
+    }
+
+    if (format != nullptr && strcmp(format, "png") != 0 && strcmp(format, "ppm") != 0)
+    {
+        std::cerr << "Invalid format: " << format << std::endl;
+        return -1;
+    }
+
+    if (fps <= 0)
+    {
+        std::cerr << "Invalid frame rate: " << fps << std::endl;
+        return -1;
+    }
+
+    Camera cam(CAMERA_EYE_POSITION, CAMERA_CENTER_POSITION, CAMERA_UP_VECTOR, CAMERA_ROTATE_SPEED, CAMERA_TRANSLATE_SPEED, keys);
+    GL_Prog prog("shaders/vs.glsl", "shaders/fs.glsl", width, height);
+
+    root = createModel(model_type);
+
+    name_to_animations = loadModelAnimations();
+
+    std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>();
+    Simulation simulation(getRigs(argc, argv), getCrowdSize(argc, argv));
+
+    simulation.setFrameTime(replay != nullptr ? replay->frame_time : 1.0 / fps);
+    simulation.setLockstep(replay != nullptr);
+    simulation.setRestPose(root->getAnimations());
+    simulation.setView(cam.getViewMatrix(), getProjection((float)width / height), cam.eye);
+    bakeStartupPoseCache(simulation.getSkeleton(), argc, argv);
+    compressStartupClips(argc, argv);
+    playStartupAnimation(simulation, argc, argv);
+    loadStartupStateMachine(simulation, argc, argv);
+    addStartupLayer(simulation, argc, argv);
+    plantStartupFeet(simulation, argc, argv);
+
+    std::unique_ptr<PoseCompute> compute = createPoseCompute(prog, simulation, *renderer, argc, argv);
+    bool instanced = renderer->isBatched();
+    GLuint shaderProgram = instanced ? prog.createProgram("shaders/instanced_vs.glsl", "shaders/instanced_fs.glsl")
+                                     : prog.getShaderProgram();
+
+    if (frames == 0 && replay != nullptr)
+        frames = replay->frame_count;
+    if (frames == 0 && getOption(argc, argv, "--play") != nullptr)
+        frames = ceil(name_to_animations[getOption(argc, argv, "--play")].rbegin()->first * fps);
+    if (frames == 0)
+        frames = 1;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t next_event = 0;
+
+    GpuTimer gpu_timer;
+
+    simulation.start();
+
+    {
+        FrameCapture capture(width, height, directory, format != nullptr && strcmp(format, "ppm") == 0 ? Ppm : Png);
+
+        for (size_t i = 0; i < frames; i++)
+        {
+            PROFILE_SCOPE(FrameZone);
+            const PoseFrame *pose;
+
+            {
+                PROFILE_SCOPE(WaitZone);
+
+                pose = simulation.acquireNext();
+            }
+
+            // a replay goes through the same steps as the windowed loop it was recorded in
+            if (replay != nullptr && pose != nullptr && pose->playing)
+                root->setAnimations(pose->locals);
+
+            {
+                PROFILE_SCOPE(RenderZone);
+
+                if (compute != nullptr && pose != nullptr && pose->gpu)
+                {
+                    gpu_timer.begin(PosePass);
+                    compute->evaluate(*pose);
+                    gpu_timer.end();
+                }
+
+                capture.bind();
+                gpu_timer.begin(ScenePass);
+                renderScene(shaderProgram, cam, *renderer, pose, (float)width / height);
+                gpu_timer.end();
+                capture.capture();
+            }
+
+            profiler.setCounter(BonesCounter, pose != nullptr ? pose->total_bones : 0);
+            profiler.setCounter(ClipsCounter, name_to_animations.size());
+            profiler.endFrame();
+            gpu_timer.endFrame();
+
+            if (replay == nullptr)
+                continue;
+
+            replayFrame(*replay, next_event, i, simulation, cam);
+            simulation.setRestPose(root->getAnimations());
+            simulation.setView(cam.getViewMatrix(), getProjection((float)width / height), cam.eye);
+            simulation.submit();
+        }
+    }
+
+    if (replay != nullptr)
+        printReplayTime(frames, start);
+    if (profiler.isEnabled())
+        printProfile(gpu_timer);
+
+    simulation.stop();
+    profiler.stopTrace();
+
+    if (instanced)
+        glDeleteProgram(shaderProgram);
+    compute.reset();
+    renderer.reset();
+
+    std::cout << "Captured " << frames << " frame(s) into " << directory << std::endl;
+
+    root->clear();
+
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     if (argc > 1 && string(argv[1]) == "-h")
     {
-        std::cerr << "Usage: " << argv[0] << " [human|alien (default: human)]" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [human|alien (default: human)] [--crowd count (default: " << CROWD_SIZE << ") [--mix]]"
+                  << " [--play animation] [--loop | --mode once|loop|ping-pong|clamp] [--root-motion]" << std::endl
+                  << "       [--interpolation step|linear|hermite|catmull-rom] [--states file]" << std::endl
+                  << "       [--layer animation [--additive] [--mask bone,...]] [--plant-feet two-bone|ccd|fabrik]" << std::endl
+                  << "       [--cache rate] [--compress tolerance] [--gpu (linear clips only)] [--record file | --replay file]" << std::endl
+                  << "       [--profile] [--trace file.json]" << std::endl
+                  << "       [--capture directory [--size WxH] [--fps rate (default: " << CAPTURE_FPS << ")]"
+                  << " [--frames count] [--format png|ppm (default: png)]]" << std::endl;
         return 0;
     }
 
     model_type = getModelType(argc, argv);
+    interpolation = getInterpolation(argc, argv);
+    startProfiler(argc, argv);
+
+    const char *capture_directory = getOption(argc, argv, "--capture");
+
+    if (capture_directory != nullptr)
+        return runOffscreen(argc, argv, capture_directory);
+
+    size_t crowd_size = getCrowdSize(argc, argv);
+    std::shared_ptr<const Replay> replay = loadStartupReplay(argc, argv);
+    const char *record_path = getOption(argc, argv, "--record");
+    bool lockstep = replay != nullptr || record_path != nullptr;
 
     Camera cam(CAMERA_EYE_POSITION, CAMERA_CENTER_POSITION, CAMERA_UP_VECTOR, CAMERA_ROTATE_SPEED, CAMERA_TRANSLATE_SPEED, keys);
     GL_Prog prog("shaders/vs.glsl", "shaders/fs.glsl", key_callback, mouse_callback, WINDOW_WIDTH, WINDOW_HEIGHT);
 
     auto window = prog.getWindow();
-    auto shaderProgram = prog.getShaderProgram();
 
     root = createModel(model_type);
 
-    name_to_animations = loadAnimationsFromDir(DEFAULT_ANIMATIONS_DIRECTORY, root->getChildrenCount());
-
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-
-    ImGui::StyleColorsDark();
+    name_to_animations = loadModelAnimations();
 
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 400");
+    std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>();
+    Simulation simulation(getRigs(argc, argv), crowd_size);
 
-    while (!glfwWindowShouldClose(window))
+    // recordings and replays advance by a fixed step per frame, each frame evaluated with
+    // exactly the inputs of the one before
+    if (lockstep)
     {
-        glEnable(GL_DEPTH_TEST);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glUseProgram(shaderProgram);
-        glClearColor(background_color[0], background_color[1], background_color[2], background_color[3]);
-
-        mat view = cam.getViewMatrix();
-        mat projection = perspective(M_PI / 4, prog.getWidth() / prog.getHeight(), 0.1f, 100.0f);
-
-        vec buff_view(view.begin(), view.end());
-        vec buff_projection(projection.begin(), projection.end());
-
-        GLint viewLoc = glGetUniformLocation(shaderProgram, "uView");
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &(buff_view[0]));
-
-        GLint projectionLoc = glGetUniformLocation(shaderProgram, "uProjection");
-        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, &(buff_projection[0]));
+        simulation.setFrameTime(replay != nullptr ? replay->frame_time : REPLAY_FRAME_TIME);
+        simulation.setLockstep(true);
+    }
+    simulation.setRestPose(root->getAnimations());
+    bakeStartupPoseCache(simulation.getSkeleton(), argc, argv);
+    compressStartupClips(argc, argv);
+    playStartupAnimation(simulation, argc, argv);
+    loadStartupStateMachine(simulation, argc, argv);
+    addStartupLayer(simulation, argc, argv);
+    plantStartupFeet(simulation, argc, argv);
+
+    // startup options are not recorded, replays are given the same ones
+    if (record_path != nullptr)
+    {
+        recorder = std::make_unique<ReplayRecorder>(record_path, REPLAY_FRAME_TIME);
+        if (!recorder->isOpen())
+            return -1;
+    }
+    replaying = replay != nullptr;
 
-        glUniform3f(glGetUniformLocation(shaderProgram, "Color"), 1.0f, 0.0f, 0.0f);
+    std::unique_ptr<PoseCompute> compute = createPoseCompute(prog, simulation, *renderer, argc, argv);
+    bool instanced = renderer->isBatched();
+    GLuint shaderProgram = instanced ? prog.createProgram("shaders/instanced_vs.glsl", "shaders/instanced_fs.glsl")
+                                     : prog.getShaderProgram();
 
-        if (current_animation != nullptr && std::chrono::high_resolution_clock::now() > end_time)
-            current_animation = nullptr;
+    std::unique_ptr<GpuTimer> gpu_timer = std::make_unique<GpuTimer>();
 
-        if (current_animation == nullptr)
-            root->applyTransforms(mat(4));
-        else
-            runAnimations(root, *current_animation, start_time);
+    simulation.start();
 
-        root->renderModel(shaderProgram);
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
 
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+    ImGui::StyleColorsDark();
 
-        boneEditor(root);
-        animationEditor(root);
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init("#version 400");
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    auto start = std::chrono::steady_clock::now();
+    size_t frame = 0;
+    size_t next_event = 0;
 
-        glfwSwapBuffers(window);
+    while (!glfwWindowShouldClose(window) && (replay == nullptr || frame < replay->frame_count))
+    {
+        PROFILE_SCOPE(FrameZone);
+        const PoseFrame *pose;
+
+        {
+            PROFILE_SCOPE(WaitZone);
+
+            pose = lockstep ? simulation.acquireNext() : simulation.acquire();
+        }
+
+        if (pose != nullptr && pose->playing)
+            root->setAnimations(pose->locals);
+
+        {
+            PROFILE_SCOPE(RenderZone);
+
+            if (compute != nullptr && pose != nullptr && pose->gpu)
+            {
+                gpu_timer->begin(PosePass);
+                compute->evaluate(*pose);
+                gpu_timer->end();
+            }
+
+            gpu_timer->begin(ScenePass);
+            renderScene(shaderProgram, cam, *renderer, pose, (float)prog.getWidth() / prog.getHeight());
+            gpu_timer->end();
+        }
+
+        {
+            PROFILE_SCOPE(ImGuiZone);
+
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+
+            if (replay != nullptr)
+                replayFrame(*replay, next_event, frame, simulation, cam);
+            else
+            {
+                std::vector<float> rest = recorder != nullptr ? getRestPoseValues() : std::vector<float>();
+
+                boneEditor(root);
+                animationEditor(root, simulation);
+
+                if (recorder != nullptr && getRestPoseValues() != rest)
+                    recordEvent(ReplayEvent(RestPoseEvent, 0, getRestPoseValues()));
+            }
+            profilerEditor();
+            gpuTimingEditor(*gpu_timer);
+
+            ImGui::Render();
+            gpu_timer->begin(ImGuiPass);
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            gpu_timer->end();
+        }
+
+        {
+            PROFILE_SCOPE(SwapZone);
+
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
 
-        if (!ImGui::GetIO().WantCaptureMouse)
+        if (replay == nullptr && !ImGui::GetIO().WantCaptureMouse)
             cam.update(window);
+        if (recorder != nullptr)
+            recordEvent(ReplayEvent(CameraEvent, 0, getCameraValues(cam)));
+
+        simulation.setRestPose(root->getAnimations());
+        simulation.setView(cam.getViewMatrix(), getProjection((float)prog.getWidth() / prog.getHeight()), cam.eye);
+
+        if (lockstep)
+            simulation.submit();
+        if (recorder != nullptr)
+            recorder->endFrame();
+        profiler.setCounter(BonesCounter, pose != nullptr ? pose->total_bones : 0);
+        profiler.setCounter(ClipsCounter, name_to_animations.size());
+        profiler.endFrame();
+        gpu_timer->endFrame();
+        frame++;
     }
 
+    simulation.stop();
+    recorder.reset();
+    profiler.stopTrace();
+
+    if (replay != nullptr)
+        printReplayTime(frame, start);
+    if (profiler.isEnabled())
+        printProfile(*gpu_timer);
+
+    if (instanced)
+        glDeleteProgram(shaderProgram);
+    compute.reset();
+    renderer.reset();
+    gpu_timer.reset();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -8,10 +8,61 @@
 #define CAMERA_TRANSLATE_SPEED 0.1f
 
 #define DEFAULT_ANIMATIONS_DIRECTORY "anim"
+#define DEFAULT_STATE_MACHINE "states/locomotion.states"
+
+#define BAKE_SAMPLE_RATE 30.0f
+#define BAKE_OUTPUT "poses"
+#define POSE_CACHE_RATE 60.0f
+#define CLIP_COMPRESSION_TOLERANCE 0.001f
+#define TRACK_IMPORT_TOLERANCE 0.00001f
+
+#define SIMULATION_STEP (1.0 / 60.0)
+#define SIMULATION_MAX_STEPS 8
+
+// simulated seconds per frame while recording a replay
+#define REPLAY_FRAME_TIME (1.0 / 60.0)
+
+#define INSTANCE_RING_SIZE 3
+#define INSTANCE_BUFFER_BONES 1024
+
+#define POSE_COMPUTE_MAX_BONES 32
+#define POSE_COMPUTE_GROUP_SIZE 64
+
+#define CROWD_SIZE 0
+#define CROWD_SPACING 5.0f
+#define CROWD_TIME_SCALE_SPREAD 0.2f
+
+#define CULL_MARGIN 1.0f
+
+#define IK_CCD_ITERATIONS 10
+#define IK_FABRIK_ITERATIONS 10
+#define FOOT_IK_CHAINS {{"leftThigh", "leftCalf"}, {"rightThigh", "rightCalf"}}
+#define IK_TOLERANCE 0.001f
+
+// seconds over which the previous clip fades out when another one is played
+#define CROSSFADE_DURATION 0.25f
+
+// level n evaluates poses every 2^n frames, below these fractions of the viewport height
+#define LOD_LEVELS 3
+#define LOD_SCREEN_SIZES {0.25f, 0.12f}
+
+// 0 compiles the profiler's timers out entirely
+#define PROFILER 1
+// samples per thread, drained every frame
+#define PROFILER_RING_SIZE 16384
+// frames averaged and plotted
+#define PROFILER_HISTORY 120
+// frames before GPU timer queries are read back
+#define GPU_TIMER_LATENCY 4
+// 0 leaves operator new alone, allocations are then never counted
+#define ALLOCATION_TRACKING 1
 
 #define WINDOW_WIDTH 1000
 #define WINDOW_HEIGHT 1000
 
+#define CAPTURE_FPS 30.0
+#define CAPTURE_PBO_COUNT 3
+
 #define BACKGROUND_COLOR_R 0.4f
 #define BACKGROUND_COLOR_G 0.4f
 #define BACKGROUND_COLOR_B 0.5f
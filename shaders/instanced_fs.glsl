@@ -0,0 +1,7 @@
+#version 430 core
+flat in vec3 vColor;
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(vColor, 1.0);
+}
\ No newline at end of file
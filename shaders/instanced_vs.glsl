@@ -0,0 +1,13 @@
+#version 430 core
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in uint aBone;
+layout(std430, binding = 0) readonly buffer Transforms { mat4 transforms[]; };
+layout(std430, binding = 1) readonly buffer Colors { float colors[]; }; // 3 per bone
+uniform mat4 uView;
+uniform mat4 uProjection;
+flat out vec3 vColor;
+
+void main() {
+    vColor = vec3(colors[3 * aBone], colors[3 * aBone + 1], colors[3 * aBone + 2]);
+    gl_Position = uProjection * uView * transforms[aBone] * vec4(aPosition, 1.0);
+}
\ No newline at end of file
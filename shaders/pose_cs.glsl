@@ -0,0 +1,98 @@
+#version 430 core
+// must match POSE_COMPUTE_MAX_BONES and POSE_COMPUTE_GROUP_SIZE in settings.hpp
+#define MAX_BONES 32
+layout(local_size_x = 64) in;
+
+struct Instance {
+    vec4 offset_time; // root offset, sample time
+    uvec4 clip;       // first key time, key count, first key
+    uvec4 rig;        // first parent, bone count, first output bone
+};
+
+layout(std430, binding = 0) writeonly buffer Transforms { mat4 transforms[]; };
+layout(std430, binding = 1) writeonly buffer Colors { float colors[]; }; // 3 per bone
+layout(std430, binding = 2) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 3) readonly buffer KeyTimes { float key_times[]; };
+// translation, rotation, scale and color of every bone, key after key
+layout(std430, binding = 4) readonly buffer Keys { vec4 keys[]; };
+layout(std430, binding = 5) readonly buffer Parents { int parents[]; }; // every rig, one after the other
+
+uniform uint uInstanceCount;
+
+mat4 translation(vec3 t) {
+    mat4 m = mat4(1.0);
+    m[3] = vec4(t, 1.0);
+    return m;
+}
+
+mat4 scaling(vec3 s) {
+    return mat4(vec4(s.x, 0.0, 0.0, 0.0), vec4(0.0, s.y, 0.0, 0.0), vec4(0.0, 0.0, s.z, 0.0), vec4(0.0, 0.0, 0.0, 1.0));
+}
+
+// The CPU builds row-major matrices applied to row vectors, so every matrix here is the
+// transpose of its CPU counterpart and products are taken in reverse order
+mat4 rotation(vec3 r) {
+    float cr = cos(r.x), sr = sin(r.x);
+    float cp = cos(r.y), sp = sin(r.y);
+    float cy = cos(r.z), sy = sin(r.z);
+
+    return mat4(cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr, 0.0,
+                sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr, 0.0,
+                -sp, cp * sr, cp * cr, 0.0,
+                0.0, 0.0, 0.0, 1.0);
+}
+
+vec4 key(Instance instance, uint index, uint bone, uint channel) {
+    return keys[instance.clip.z + (index * instance.rig.y + bone) * 4 + channel];
+}
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+
+    if (id >= uInstanceCount)
+        return;
+
+    Instance instance = instances[id];
+    float t = instance.offset_time.w;
+    uint times = instance.clip.x;
+    uint last = instance.clip.y - 1;
+
+    // last key at or before t
+    uint before = 0;
+    uint high = last;
+    while (before < high) {
+        uint mid = (before + high + 1) / 2;
+        if (key_times[times + mid] <= t)
+            before = mid;
+        else
+            high = mid - 1;
+    }
+
+    uint after = min(before + 1, last);
+    float span = key_times[times + after] - key_times[times + before];
+    float alpha = span > 0.0 ? clamp((t - key_times[times + before]) / span, 0.0, 1.0) : 0.0;
+
+    mat4 world[MAX_BONES];
+    vec3 dims[MAX_BONES];
+
+    for (uint bone = 0; bone < instance.rig.y; bone++) {
+        vec3 position = mix(key(instance, before, bone, 0).xyz, key(instance, after, bone, 0).xyz, alpha);
+        vec3 angles = mix(key(instance, before, bone, 1).xyz, key(instance, after, bone, 1).xyz, alpha);
+        vec4 color = mix(key(instance, before, bone, 3), key(instance, after, bone, 3), alpha);
+        int parent = parents[instance.rig.x + bone];
+        uint index = instance.rig.z + bone;
+
+        dims[bone] = max(mix(key(instance, before, bone, 2).xyz, key(instance, after, bone, 2).xyz, alpha), vec3(0.0000000000001));
+
+        mat4 local = rotation(angles) * scaling(dims[bone]);
+
+        if (parent >= 0)
+            world[bone] = world[parent] * translation(position) * scaling(1.0 / dims[parent]) * local;
+        else
+            world[bone] = translation(instance.offset_time.xyz) * translation(position) * local;
+
+        transforms[index] = world[bone];
+        for (uint c = 0; c < 3; c++)
+            colors[3 * index + c] = color[c];
+    }
+}
\ No newline at end of file